@@ -0,0 +1,34 @@
+#!/bin/sh
+# Write every shader in directory $1 into the C++ header $2 as string data, so the binary never reads them at
+# startup. The header is only replaced when a shader changed, so make doesn't rebuild for nothing
+set -e
+
+directory=$1
+header=$2
+temporary="$header.tmp"
+mkdir -p "$(dirname "$header")"
+
+{
+    echo "// Generated from $directory by embedShaders.sh, do not edit"
+    echo "#ifndef EMBEDDED_SHADERS_H"
+    echo "#define EMBEDDED_SHADERS_H"
+    echo
+    echo "struct EmbeddedShader"
+    echo "{"
+    echo "    const char *name;  // File name in $directory"
+    echo "    const char *source;"
+    echo "};"
+    echo
+    echo "inline constexpr EmbeddedShader EMBEDDED_SHADERS[] = {"
+    for file in "$directory"/*.vert "$directory"/*.frag "$directory"/*.glsl "$directory"/*.comp; do
+        [ -f "$file" ] || continue
+        printf '    { "%s", R"embedded(' "$(basename "$file")"
+        cat "$file"
+        printf ')embedded" },\n'
+    done
+    echo "};"
+    echo
+    echo "#endif"
+} > "$temporary"
+
+if cmp -s "$temporary" "$header"; then rm "$temporary"; else mv "$temporary" "$header"; fi
@@ -10,26 +10,36 @@ project "main"
     objdir "obj/%{cfg.buildcfg}"
 
     files { "src/**.cpp", "src/**.h" }
-    includedirs { "include", "/usr/include" }
+    includedirs { "include", "/usr/include", "obj/generated" }
     libdirs { "/usr/lib" }
 
+    -- Compile the shaders into the binary
+    prebuildcommands {
+        "sh embedShaders.sh src/shaders obj/generated/embeddedShaders.h"
+    }
+
     -- Link libraries
     links {
         "glfw",
         "GLEW",
-        "GL"
+        "GL",
+        "z",
+        "pthread"
     }
 
     -- Compiler and linker settings
     filter "system:linux"
         buildoptions { "-std=c++17" }
-        links { "GL", "glfw", "GLEW" }
+        links { "GL", "glfw", "GLEW", "z", "pthread" }
     
     filter "configurations:Debug"
         defines { "DEBUG" }
         symbols "On"
 
+        -- A kernel that disagrees between C++ and GLSL, or a misframed Deep Zoom level, fails the build before the app runs
         postbuildcommands {
+            "%{cfg.targetdir}/main --check-kernel",
+            "%{cfg.targetdir}/main --check-deep-zoom",
             "%{cfg.targetdir}/main 2> /dev/null"
         }
 
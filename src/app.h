@@ -15,10 +15,26 @@
 #include "debug.h"
 #include "utils.h"
 #include "shader.h"
+#include "shaderCompiler.h"
+#include "fileWatcher.h"
 #include "window.h"
 #include "fullQuad.h"
 #include "renderer.h"
+#include "renderBudget.h"
+#include "tileScheduler.h"
+#include "dynamicResolution.h"
+#include "denoiser.h"
+#include "pixelReadback.h"
+#include "imageWriter.h"
+#include "frameWriter.h"
+#include "frameSequence.h"
+#include "layerExport.h"
+#include "posterRender.h"
+#include "deepZoom.h"
+#include "videoStream.h"
 #include "frameInterpolator.h"
+#include "kernelCheck.h"
+#include "uniformBench.h"
 
 class App
 {
@@ -30,8 +46,8 @@ public:
         glfwSetErrorCallback(errorCallBack);
         glfwInit();
 
-        // GLFW window hints and context creation
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        // GLFW window hints and context creation, GL 4.3 enables the compute backend and 3.3 is enough for the rest
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
         glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
         glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
         glfwWindowHint(GLFW_PLATFORM, GLFW_PLATFORM_X11);
@@ -41,12 +57,32 @@ public:
         const GLFWvidmode* mode = glfwGetVideoMode(primaryMonitor);
         // window = glfwCreateWindow(mode->width, mode->height, "Title", primaryMonitor, NULL);
         window = glfwCreateWindow(windowWidth, windowHeight, "Title", NULL, NULL); // Original..
+        if (!window)
+        {
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+            window = glfwCreateWindow(windowWidth, windowHeight, "Title", NULL, NULL);
+        }
         glfwMakeContextCurrent(window);
         glfwSwapInterval(1);  // Enable vsync
 
         // Initialize GLAD/GLEW
         // gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
         glewInit();
+
+        // Shaders are built on a worker from here on. They come from the binary, unless SHADER_DIRECTORY names a
+        // directory to read them from, which debug builds default to, and there they're rebuilt whenever one is saved
+        shaderCompiler.init(window);
+        Shader::compiler = &shaderCompiler;
+        const char *shaderDirectory = getenv("SHADER_DIRECTORY");
+#ifdef DEBUG
+        if (!shaderDirectory) shaderDirectory = "./src/shaders";
+#endif
+        if (shaderDirectory && *shaderDirectory)
+        {
+            Shader::sourceDirectory = shaderDirectory;
+            shaderWatcher.init(shaderDirectory);
+        }
         
         // Enable blending
         glEnable(GL_BLEND);
@@ -57,11 +93,34 @@ public:
 
         initImGui();
         quad.init();
+        budget.init();
+        denoiser.init();
+        readback.init([this](const PixelReadback::Frame &frame) { queueFrame(frame); });
+        frameWriter.start(glm::clamp((int)std::thread::hardware_concurrency() - 1, 1, 4), 4);
+        videoStream.init();
+        layers.init();
+        poster.init();
+        deepZoom.init(&frameWriter);
+        sequenceReadback.init([this](const PixelReadback::Frame &frame) { queueSequenceFrame(frame); });
+        glGenTextures(1, &sequencePreviewTexture);
+        streamReadback.init([this](const PixelReadback::Frame &frame) { videoStream.push(frame); });
         renderer = Renderer(sceneWindow.resolution());
     }
 
     ~App()
     {
+        // Finish writing any frame still being read back
+        readback.flush();
+        sequenceReadback.flush();
+        deepZoom.cancel();
+        frameWriter.stop();
+        streamReadback.flush();
+        videoStream.close();
+        poster.cancel();
+        Shader::compiler = nullptr;
+        shaderCompiler.stop();
+        shaderWatcher.stop();
+
         ImGui_ImplOpenGL3_Shutdown();
         ImGui_ImplGlfw_Shutdown();
         ImGui::DestroyContext();
@@ -80,61 +139,210 @@ public:
             ImGui::Begin("Viewport", nullptr, ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse);
             {
                 pollEvents();
-
-                // Get previous frame texture unit and bind it (this way we can use it in the scene shader as a uniform)
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, sceneWindow.textures[!pingpong]);
-
-                // Bind and clear current frame buffer (this way anything we render gets rendered on this FBO's texture)
-                glBindFramebuffer(GL_FRAMEBUFFER, sceneWindow.FBOs[pingpong]);
-                glViewport(0, 0, sceneWindow.width, sceneWindow.height);
-                glClear(GL_COLOR_BUFFER_BIT);
+                updateRenderScale();
+
+                // Render as much of the scene as the frame budget allows
+                if (budget.isTiled())
+                {
+                    // Without accumulation, extra passes would just redraw the same image
+                    int maxTiles = renderer.isAccumulating() ? tiles.getTileCount() * budget.maxPasses : tiles.getTilesRemaining();
+                    renderTiles(budget.beginFrame(maxTiles));
+                }
+                else
+                {
+                    tiles.cancelPass();
+                    int passes = budget.beginFrame(renderer.isAccumulating() ? budget.maxPasses : 1);
+                    for (int i = 0; i < passes; i++)
+                        renderPass();
+                }
+                budget.endFrame();
+
+                // Denoise a copy for display, the history keeps accumulating the noisy passes
+                glm::ivec2 renderResolution = sceneWindow.renderResolution();
+                displayTexture = sceneWindow.textures[!pingpong];
+                displayFBO = sceneWindow.FBOs[!pingpong];
+                if (denoiser.enabled)
+                {
+                    renderer.updateGuide(quad, sceneWindow);
+                    denoiser.apply(quad, sceneWindow, displayTexture, renderResolution, renderer.getAccumulatedPasses());
+                    displayTexture = denoiser.getTexture();
+                    displayFBO = denoiser.getFBO();
+                }
                 
-                // Render the scene
-                renderer.renderScene(0);
-                quad.render();
-
-                // Unbind current FBO and previous texture
-                glBindFramebuffer(GL_FRAMEBUFFER, 0);
-                glBindTexture(GL_TEXTURE_2D, 0);
-                
-                // Display current texture on ImGui window
-                ImGui::ImageButton((ImTextureID)(intptr_t)sceneWindow.textures[pingpong], ImVec2(sceneWindow.width, sceneWindow.height), ImVec2(0, 1), ImVec2(1, 0), 0);
-
-                // Swap pingpong boolean for the next iteration
-                pingpong = !pingpong;
+                // Display latest texture on ImGui window, upscaling the rendered corner to the whole window
+                ImVec2 uvMax(renderResolution.x / (float)sceneWindow.width, renderResolution.y / (float)sceneWindow.height);
+                ImGui::ImageButton((ImTextureID)(intptr_t)displayTexture, ImVec2(sceneWindow.width, sceneWindow.height), ImVec2(0, uvMax.y), ImVec2(uvMax.x, 0), 0);
             }
             ImGui::End();
             
             gui();
+            readback.poll();
+
+            // A poster renders in the time left over from the frame
+            if (poster.isActive()) poster.update(quad, 30.0f);
+            else if (deepZoom.isActive()) deepZoom.update(quad, 30.0f);
             
             endFrame();
         }
     }
 
+    // Time the per-pass uniform work instead of running the app
+    void benchUniforms()
+    {
+        UniformBench::run(renderer);
+    }
+
+    // Whether the kernel compiled as C++ and as GLSL agrees, the functions that don't are printed
+    bool checkKernel()
+    {
+        return KernelCheck::run(quad);
+    }
+
+    // Whether the coarse levels of a Deep Zoom pyramid match the full image averaged down, the ones that don't are printed
+    bool checkDeepZoom()
+    {
+        return DeepZoom::checkLevels(renderer, quad);
+    }
+
 private:
 
+    enum ExportDestination { EXPORT_FILES = 0, EXPORT_SEQUENCE = 1, EXPORT_STREAM = 2 };
+
     GLFWwindow *window;
+    ShaderCompiler shaderCompiler;
+    FileWatcher shaderWatcher;
     FrameInterpolator frameInterpolator;
     FullQuad quad;
     Window sceneWindow;
     Renderer renderer;
+    RenderBudget budget;
+    TileScheduler tiles;
+    DynamicResolution dynamicResolution;
+    Denoiser denoiser;
+    PixelReadback readback;
+    FrameWriter frameWriter;
+    FrameSequence sequence;
+    PixelReadback sequenceReadback;  // The tag of every read is its frame in the sequence
+    GLuint sequencePreviewTexture = 0;
+    VideoStream videoStream;
+    PixelReadback streamReadback;  // Kept apart from `readback` so streamed frames stay in order
+    int imageFormat = ImageWriter::P6;
+    LayerExport layers;
+    bool saveLayers = false;  // Write an EXR of every layer next to each saved image
+    PosterRender poster;
+    DeepZoom deepZoom;
+    int lastSceneVersion = 0;
     bool pingpong = false;
+    GLuint displayTexture = 0, displayFBO = 0;  // What the viewport shows and screenshots save
+
+    void updateRenderScale()
+    {
+        // Any change to the scene since the last frame counts as interaction
+        bool interacting = renderer.getSceneVersion() != lastSceneVersion;
+        float passMs = budget.isTiled() ? budget.getMsPerUnit() * tiles.getTileCount() : budget.getMsPerUnit();
+
+        // Exported frames are always rendered at full resolution
+        float scale = frameInterpolator.isActive() ? 1.0f : dynamicResolution.update(interacting, passMs, ImGui::GetTime());
+        if (scale != sceneWindow.renderScale)
+        {
+            sceneWindow.renderScale = scale;
+            renderer.setResolution(sceneWindow.renderResolution());
+        }
+
+        lastSceneVersion = renderer.getSceneVersion();
+    }
+
+    void renderPass()
+    {
+        glm::ivec2 renderResolution = sceneWindow.renderResolution();
+
+        renderer.beginPass(0);
+        renderer.draw(quad, sceneWindow, pingpong, glm::ivec4(0, 0, renderResolution.x, renderResolution.y));
+        renderer.endPass();
+
+        // Swap pingpong boolean for the next pass
+        pingpong = !pingpong;
+    }
+
+    void renderTiles(int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            // Start a new pass, or restart it if the scene changed halfway through
+            if (!tiles.isPassActive(renderer.getSceneVersion()))
+            {
+                renderer.beginPass(0);
+                tiles.beginPass(sceneWindow.renderResolution(), renderer.getSceneVersion());
+            }
+
+            renderer.draw(quad, sceneWindow, pingpong, tiles.nextTile());
+
+            if (tiles.isPassFinished())
+            {
+                renderer.endPass();
+                pingpong = !pingpong;
+            }
+        }
+    }
 
     void gui()
     {
         ImGui::Begin("Menu");
         renderer.menu(&frameInterpolator);
 
+        if (ImGui::CollapsingHeader("Performance"))
+        {
+            budget.menu();
+            if (budget.isTiled() && tiles.menu()) budget.resetEstimate();
+            dynamicResolution.menu();
+        }
+
+        if (ImGui::CollapsingHeader("Denoiser"))
+        {
+            denoiser.menu();
+        }
+
         static int TAADuration = 5;
         static bool preview = false;
+        static int destination = EXPORT_FILES;
         if (ImGui::CollapsingHeader("Export"))
         {
             ImGui::SeparatorText("Image");
+            for (int format = 0; format < ImageWriter::FORMAT_COUNT; format++)
+            {
+                if (format > 0) ImGui::SameLine();
+                ImGui::RadioButton(ImageWriter::encoder(format).name, &imageFormat, format);
+            }
+
+            ImGui::Checkbox("Also save EXR layers", &saveLayers);
+
             if (ImGui::Button("Save Screenshot"))
             {
-                saveScreenshot("./screenshots/test.ppm");
+                saveScreenshot("./screenshots/test");
+            }
+
+            ImGui::SeparatorText("Poster");
+            poster.menu();
+            if (poster.isActive())
+            {
+                ImGui::ProgressBar(poster.getProgress());
+                if (ImGui::Button("Cancel Poster")) poster.cancel();
             }
+            else if (deepZoom.isActive())
+            {
+                ImGui::ProgressBar(deepZoom.getProgress());
+                if (ImGui::Button("Cancel Deep Zoom")) deepZoom.cancel();
+            }
+            else
+            {
+                if (ImGui::Button("Render Poster")) poster.begin(renderer, "./screenshots/poster");
+
+                // The same size as a tile pyramid for web viewers, tiles already rendered with these settings are kept
+                ImGui::SameLine();
+                if (ImGui::Button("Render Deep Zoom")) deepZoom.begin(renderer, "./screenshots/pyramid", poster.width, poster.height, poster.passesPerTile);
+            }
+            if (deepZoom.getSkippedCount() + deepZoom.getUnchangedCount() > 0)
+                ImGui::Text("Deep zoom tiles kept: %d, rewritten with the same pixels: %d", deepZoom.getSkippedCount(), deepZoom.getUnchangedCount());
 
             ImGui::SeparatorText("Frames");
 
@@ -142,10 +350,52 @@ private:
             ImGui::DragInt("Framecount", &maxVideoFrames, 1, 30, 30*1000);
             ImGui::DragInt("TAA Duration", &TAADuration, 1, 1, 1000);
 
-            if (ImGui::Button("Save Frames"))
+            ImGui::RadioButton("Files", &destination, EXPORT_FILES);
+            ImGui::SameLine();
+            ImGui::RadioButton("Sequence", &destination, EXPORT_SEQUENCE);
+            ImGui::SameLine();
+            ImGui::RadioButton("Stream", &destination, EXPORT_STREAM);
+
+            // One file for the whole animation, rerunning the export only renders the frames it's missing
+            static char sequencePath[256] = "./frames/sequence.jseq";
+            if (destination == EXPORT_SEQUENCE)
+            {
+                ImGui::InputText("Sequence file", sequencePath, sizeof(sequencePath));
+            }
+
+            // Pipe frames straight into an encoder, e.g. `ffmpeg -i pipe.y4m out.mp4`
+            static int streamFormat = VideoStream::Y4M;
+            static char streamPath[256] = "-";
+            static int frameRate = 30;
+            if (destination == EXPORT_STREAM)
+            {
+                ImGui::InputText("Output (- is stdout)", streamPath, sizeof(streamPath));
+                ImGui::RadioButton("Y4M", &streamFormat, VideoStream::Y4M);
+                ImGui::SameLine();
+                ImGui::RadioButton("Raw RGB", &streamFormat, VideoStream::RGB);
+                ImGui::DragInt("Frame rate", &frameRate, 1, 1, 240);
+            }
+
+            if (denoiser.enabled)
+            {
+                // Denoised frames converge in far fewer passes
+                ImGui::Text("Saved frames are denoised");
+            }
+
+            if (ImGui::Button(destination == EXPORT_STREAM ? "Stream Frames" : "Save Frames"))
             {
                 frameInterpolator.init(1, maxVideoFrames);
                 preview = false;
+
+                glm::ivec2 size = getExportSize();
+                if (destination == EXPORT_SEQUENCE)
+                {
+                    // Nothing may still be writing into the sequence being replaced
+                    sequenceReadback.flush();
+                    frameWriter.wait();
+                    sequence.open(sequencePath, size.x, size.y, maxVideoFrames, hashAnimation());
+                }
+                if (destination == EXPORT_STREAM) videoStream.open(streamPath, streamFormat, size.x, size.y, frameRate);
             }
 
             if (ImGui::Button("Preview"))
@@ -158,20 +408,55 @@ private:
             {
                 frameInterpolator.clear();
             }
+
+            int pending = frameWriter.getPending() + readback.getPending() + sequenceReadback.getPending() + streamReadback.getPending();
+            ImGui::Text("Frames being written: %d", pending);
+            if (videoStream.isOpen())
+            {
+                if (videoStream.hasFailed()) ImGui::Text("Stream closed, frames are dropped");
+                else if (!videoStream.isOutputOpen()) ImGui::Text("Waiting for a reader, frames dropped: %d", videoStream.getDroppedFrames());
+                else ImGui::Text("Frames streamed: %d, dropped: %d", videoStream.getFrameCount(), videoStream.getDroppedFrames());
+            }
+
+            if (sequence.isOpen()) sequenceMenu();
         }
 
-        // Update values on the frame interpolator
-        if (frameInterpolator.updateValues(TAADuration))
+        // Frames the sequence already holds from an earlier run are skipped without waiting for them to converge
+        int frame = frameInterpolator.getInterpolationValue();
+        bool writingSequence = !preview && destination == EXPORT_SEQUENCE && sequence.isOpen();
+        bool skipFrame = writingSequence && sequence.hasFrame(frame - 1);
+
+        // The displayed image is saved once `TAADuration` passes of its own settings have finished, however many
+        // frames they took in tiled or multiple pass mode, then the values move on to the next frame
+        bool converged = skipFrame || renderer.getCompletedPasses() >= TAADuration;
+        if (converged && frameInterpolator.updateValues())
         {
+            // Keyframed values can be in any of the blocks
+            renderer.markBlocksDirty();
             renderer.onUpdate();
 
-            if (!preview)
+            if (videoStream.isOpen())
+            {
+                streamFrame();
+            }
+            else if (writingSequence)
+            {
+                if (!skipFrame) sequenceReadback.request(displayFBO, 0, sequence.getWidth(), sequence.getHeight(), "", frame - 1);
+            }
+            else if (!preview)
             {
                 // Save current frame if not on preview mode
-                std::string ppmname = "./frames/" + std::to_string(frameInterpolator.getInterpolationValue() - 1) + ".ppm";
-                saveScreenshot(ppmname.c_str());
+                std::string framename = "./frames/" + std::to_string(frameInterpolator.getInterpolationValue() - 1);
+                saveScreenshot(framename.c_str());
             }
         }
+
+        // End the stream once the last frame is out
+        if (videoStream.isOpen() && !frameInterpolator.isActive())
+        {
+            streamReadback.flush();
+            videoStream.close();
+        }
                 
         ImGui::End();
     }
@@ -183,6 +468,11 @@ private:
     {
         glfwPollEvents();
         if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) glfwSetWindowShouldClose(window, true);
+
+        // Saved shaders are swapped in once they've built, and the image restarts with them
+        for (const std::string &name : shaderWatcher.poll())
+            Shader::reload(name);
+        if (Shader::update()) renderer.onUpdate();
     
         // Start the Dear ImGui frame
         ImGui_ImplOpenGL3_NewFrame();
@@ -226,7 +516,7 @@ private:
         if (windowChangedSize)
         {
             sceneWindow.updateDimensions((int)windowSize.x, (int)windowSize.y);
-            renderer.setResolution(sceneWindow.resolution());
+            renderer.setResolution(sceneWindow.renderResolution());
         }
 
         // Check if cursor is inside window
@@ -302,41 +592,136 @@ private:
         ImGui_ImplOpenGL3_Init("#version 330");
     }
 
-    void saveScreenshot(const char *ppmname)
+    // Save the displayed image to `path`, the extension is added for the selected format
+    void saveScreenshot(const char *path)
+    {
+        glm::ivec2 size = getExportSize();
+        int width = size.x;
+        int height = size.y;
+
+        // Queue the read, the file is written once the GPU has caught up
+        if (denoiser.enabled && denoiser.denoiseOnCPU)
+            readback.request(sceneWindow.FBOs[!pingpong], sceneWindow.guideFBO, width, height, path, renderer.getAccumulatedPasses());
+        else
+            readback.request(displayFBO, 0, width, height, path);
+
+        if (saveLayers) saveLayerImage(path);
+    }
+
+    // Render the layers of the displayed image and queue them as an EXR next to it. Read back straight away, which is
+    // fine for an offline export and keeps the float planes out of the pixel buffer ring
+    void saveLayerImage(const char *path)
+    {
+        if (!layers.capture(renderer, quad))
+        {
+            std::cerr << "The layers of " << path << " weren't saved, the scene shader doesn't build" << std::endl;
+            return;
+        }
+
+        FrameWriter::Job *job = frameWriter.acquire();
+        job->path = path;
+        job->width = layers.getSize().x;
+        job->height = layers.getSize().y;
+        layers.read(job->layers);
+
+        frameWriter.submit(job);
+    }
+
+    // Queue the displayed image on the video stream, converted to YUV on the GPU first for Y4M
+    void streamFrame()
+    {
+        GLuint fbo = displayFBO;
+        if (videoStream.getFormat() == VideoStream::Y4M) fbo = videoStream.convert(quad, displayTexture);
+
+        glm::ivec2 size = videoStream.getReadSize();
+        streamReadback.request(fbo, 0, size.x, size.y, "", 0, videoStream.getReadFormat());
+    }
+
+    // Exported images are the window rounded up to even dimensions, which 4:2:0 video needs
+    glm::ivec2 getExportSize() const
     {
         int width = sceneWindow.width;
         int height = sceneWindow.height;
 
         if (width % 2 != 0) width++;
         if (height % 2 != 0) height++;
-        
-        // Get texture pixel buffer
-        std::vector<unsigned char> pixels(width * height * 4);
-        glBindFramebuffer(GL_FRAMEBUFFER, sceneWindow.FBOs[pingpong]);
-        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        // Flip pixels
-        std::vector<unsigned char> flippedPixels(width * height * 4);
-        for (int y = 0; y < height; ++y)
+
+        return glm::ivec2(width, height);
+    }
+
+    // What a sequence is resumed against: the keyframes, and the scene at the first frame. The keyframed values are
+    // set to where the animation starts, as the export's first frame would, so an interrupted export hashes the same
+    uint64_t hashAnimation()
+    {
+        frameInterpolator.applyInitialValues();
+        return renderer.hashScene() ^ frameInterpolator.hash(&renderer);
+    }
+
+    // Copy a frame out of its pixel buffer and hand it to the writer threads
+    void queueFrame(const PixelReadback::Frame &frame)
+    {
+        FrameWriter::Job *job = frameWriter.acquire();
+        job->path = frame.name;
+        job->width = frame.width;
+        job->height = frame.height;
+        job->format = imageFormat;
+        job->pixels.assign(frame.pixels, frame.pixels + frame.width * frame.height * 3);
+
+        // Frames read back with their guide are denoised on the CPU, the tag holds their pass count
+        if (frame.guide) job->guide.assign(frame.guide, frame.guide + frame.width * frame.height);
+        job->passCount = frame.tag;
+        job->denoiseSettings = denoiser.settings;
+
+        frameWriter.submit(job);
+    }
+
+    // Same as `queueFrame` for a frame of the sequence, it was denoised on the GPU if at all
+    void queueSequenceFrame(const PixelReadback::Frame &frame)
+    {
+        FrameWriter::Job *job = frameWriter.acquire();
+        job->width = frame.width;
+        job->height = frame.height;
+        job->pixels.assign(frame.pixels, frame.pixels + frame.width * frame.height * 3);
+        job->sink = &sequence;
+        job->sinkFrame = frame.tag;
+
+        frameWriter.submit(job);
+    }
+
+    // Progress of the sequence and a preview of any frame in it
+    void sequenceMenu()
+    {
+        static int previewFrame = 0;
+        static int shownFrame = -1;
+
+        ImGui::SeparatorText("Sequence");
+        ImGui::Text("%d of %d frames written", sequence.getWrittenCount(), sequence.getFrameCount());
+
+        if (ImGui::SliderInt("Frame", &previewFrame, 1, sequence.getFrameCount())) shownFrame = -1;
+        if (ImGui::Button("Erase Frame"))
         {
-            for (int x = 0; x < width; ++x)
-            {
-                int srcIndex = (y * width + x) * 4;
-                int dstIndex = ((height - y - 1) * width + x) * 4;
-                flippedPixels[dstIndex] = pixels[srcIndex];
-                flippedPixels[dstIndex + 1] = pixels[srcIndex + 1];
-                flippedPixels[dstIndex + 2] = pixels[srcIndex + 2];
-                flippedPixels[dstIndex + 3] = pixels[srcIndex + 3];
-            }
+            // It's rendered again the next time the frames are saved
+            sequence.erase(previewFrame - 1);
+            shownFrame = -1;
+        }
+
+        // Upload the frame only when it changes or once it has been written
+        const unsigned char *pixels = sequence.read(previewFrame - 1);
+        if (!pixels) return;
+        if (shownFrame != previewFrame)
+        {
+            glBindTexture(GL_TEXTURE_2D, sequencePreviewTexture);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, sequence.getWidth(), sequence.getHeight(), 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            shownFrame = previewFrame;
         }
 
-        // Write ppm file
-        FILE *ppm = fopen(ppmname, "w");
-        fprintf(ppm, "P3\n%d %d\n255\n", width, height);
-        for (int i = 0; i < width * height * 4; i += 4)
-            fprintf(ppm, "%d %d %d ", flippedPixels[i], flippedPixels[i+1], flippedPixels[i+2]);
-        fclose(ppm);
+        float width = ImGui::GetContentRegionAvail().x;
+        ImGui::Image((ImTextureID)(intptr_t)sequencePreviewTexture, ImVec2(width, width * sequence.getHeight() / sequence.getWidth()), ImVec2(0, 1), ImVec2(1, 0));
     }
 
 };
@@ -0,0 +1,405 @@
+#ifndef DEEP_ZOOM_H
+#define DEEP_ZOOM_H
+
+#include <GL/glew.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <glm/glm.hpp>
+#include "utils.h"
+#include "renderer.h"
+#include "fullQuad.h"
+#include "pixelReadback.h"
+#include "imageWriter.h"
+#include "frameWriter.h"
+#include "frameSink.h"
+
+// Renders a Deep Zoom (DZI) tile pyramid for web viewers. Every level is rendered natively at its own resolution, framed
+// so each of its pixels covers a whole block of the full image's, tiles are written by the frame writer threads, and a
+// manifest of hashes lets a rerun skip the tiles it already has
+class DeepZoom : public FrameSink
+{
+public:
+
+    static constexpr int TILE_SIZE = 254;
+    static constexpr int OVERLAP = 1;
+
+    // Of the image `checkLevels` renders, an aspect ratio no power of two divides
+    static constexpr int CHECK_WIDTH = 50, CHECK_HEIGHT = 35;
+    static constexpr float CHECK_TOLERANCE = 1e-3f;  // Mean difference of a channel, rays that graze the fractal differ
+
+    DeepZoom() {}
+
+    void init(FrameWriter *writer)
+    {
+        frameWriter = writer;
+        glGenFramebuffers(2, FBOs);
+        glGenTextures(2, textures);
+        readback.init([this](const PixelReadback::Frame &frame) { queueTile(frame); });
+
+        // Room for a tile and its overlap on both sides, half floats so passes accumulate without banding
+        for (int i = 0; i < 2; i++)
+        {
+            glBindTexture(GL_TEXTURE_2D, textures[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, TILE_SIZE + 2*OVERLAP, TILE_SIZE + 2*OVERLAP, 0, GL_RGBA, GL_FLOAT, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, FBOs[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[i], 0);
+
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cerr << "Deep zoom frame buffer not complete" << std::endl;
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // Start a `width`*`height` pyramid of the scene as it is now, written to `path`.dzi and `path`_files
+    bool begin(const Renderer &renderer, const std::string &path, int width, int height, int passes)
+    {
+        cancel();
+
+        scene = renderer;
+        size = glm::ivec2(width, height);
+        passesPerTile = passes;
+        directory = path + "_files";
+        levelCount = (int)ceil(log2((double)glm::max(width, height))) + 1;
+
+        std::error_code error;
+        for (int level = 0; level < levelCount; level++)
+            std::filesystem::create_directories(directory + "/" + std::to_string(level), error);
+        if (error)
+        {
+            std::cerr << "Could not create " << directory << std::endl;
+            return false;
+        }
+
+        std::ofstream descriptor(path + ".dzi");
+        descriptor << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                   << "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\"png\" Overlap=\"" << OVERLAP << "\" TileSize=\"" << TILE_SIZE << "\">\n"
+                   << "    <Size Width=\"" << width << "\" Height=\"" << height << "\"/>\n"
+                   << "</Image>\n";
+
+        // Tiles rendered with the same settings as last time are kept, coarse levels first so viewers fill in quickly
+        readManifest();
+        uint64_t sceneHash = renderer.hashScene();
+        tiles.clear();
+        skippedCount = 0;
+        for (int level = 0; level < levelCount; level++)
+        {
+            glm::ivec2 grid = (getLevelSize(level) + TILE_SIZE - 1) / TILE_SIZE;
+            for (int row = 0; row < grid.y; row++)
+            {
+                for (int column = 0; column < grid.x; column++)
+                {
+                    Tile tile = { level, column, row, 0 };
+                    uint64_t settings[6] = { sceneHash, (uint64_t)passes, (uint64_t)width, (uint64_t)height, getKey(tile), (uint64_t)getDownsampling(level) };
+                    tile.settingsHash = hashBytes(settings, sizeof(settings));
+
+                    auto entry = manifest.find(getKey(tile));
+                    if (entry != manifest.end() && entry->second.settingsHash == tile.settingsHash && std::filesystem::exists(getPath(tile)))
+                        skippedCount++;
+                    else
+                        tiles.push_back(tile);
+                }
+            }
+        }
+
+        manifestFile = fopen((directory + "/manifest.txt").c_str(), "a");
+        nextTile = 0;
+        active = true;
+        return true;
+    }
+
+    // Render whole tiles for about `maxMs`, but always at least one
+    void update(FullQuad &quad, float maxMs)
+    {
+        auto start = std::chrono::steady_clock::now();
+        while (active && nextTile < (int)tiles.size())
+        {
+            const Tile &tile = tiles[nextTile];
+            glm::ivec4 rect = getRect(tile);
+            glm::ivec2 levelSize = getLevelSize(tile.level);
+
+            // Tiles count rows from the top, passes from the bottom
+            bool pingpong = false;
+            for (int pass = 0; pass < passesPerTile; pass++)
+            {
+                if (!scene.drawPosterTile(quad, FBOs[pingpong], textures[!pingpong], size, glm::ivec2(rect.x, levelSize.y - rect.y - rect.w), glm::ivec2(rect.z, rect.w), pass, getDownsampling(tile.level)))
+                {
+                    std::cerr << "Deep Zoom cancelled, the scene shader doesn't build" << std::endl;
+                    cancel();
+                    return;
+                }
+                pingpong = !pingpong;
+            }
+
+            readback.request(FBOs[!pingpong], 0, rect.z, rect.w, "", nextTile);
+            readback.poll();
+            nextTile++;
+
+            if (std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() > maxMs) break;
+        }
+
+        if (active && nextTile == (int)tiles.size()) finish();
+    }
+
+    void cancel()
+    {
+        if (active) finish();
+    }
+
+    bool isActive() const
+    {
+        return active;
+    }
+
+    float getProgress() const
+    {
+        return tiles.empty() ? 1.0f : nextTile / (float)tiles.size();
+    }
+
+    int getSkippedCount() const
+    {
+        return skippedCount;
+    }
+
+    int getUnchangedCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return unchangedCount;
+    }
+
+    // Render a few levels of a small pyramid of `renderer`'s scene and the same view at full size averaged down to each,
+    // true if they agree, the levels that don't are printed. Debug builds run it after building
+    static bool checkLevels(const Renderer &renderer, FullQuad &quad)
+    {
+        Renderer scene = renderer;
+        glm::ivec2 size(CHECK_WIDTH, CHECK_HEIGHT);
+
+        GLuint texture, fbo;
+        glGenTextures(1, &texture);
+        glGenFramebuffers(1, &fbo);
+
+        bool agree = true;
+        for (int downsampling : { 2, 4, 8 })
+        {
+            // A level pixel's grid of samples lands on the centres of the full size pixels it covers, and the full
+            // size render reaches below the image to cover the level's partial last row too
+            glm::ivec2 levelSize = (size + downsampling - 1) / downsampling;
+            glm::ivec2 fullSize = levelSize*downsampling;
+            scene.setGridSampling(downsampling);
+            std::vector<glm::vec4> level = renderCheck(scene, quad, fbo, texture, size, glm::ivec2(0, 0), levelSize, downsampling);
+            scene.setGridSampling(1);
+            std::vector<glm::vec4> full = renderCheck(scene, quad, fbo, texture, size, glm::ivec2(0, size.y - fullSize.y), fullSize, 1);
+            if (level.empty() || full.empty())
+            {
+                agree = false;
+                break;
+            }
+
+            double error = 0.0;
+            for (int y = 0; y < levelSize.y; y++)
+            {
+                for (int x = 0; x < levelSize.x; x++)
+                {
+                    glm::vec4 average(0.0f);
+                    for (int j = 0; j < downsampling; j++)
+                        for (int i = 0; i < downsampling; i++)
+                            average += full[(size_t)(y*downsampling + j)*fullSize.x + x*downsampling + i];
+                    average /= (float)(downsampling*downsampling);
+
+                    glm::vec3 difference = glm::abs(glm::vec3(level[(size_t)y*levelSize.x + x] - average));
+                    error += difference.x + difference.y + difference.z;
+                }
+            }
+            error /= 3.0 * levelSize.x * levelSize.y;
+
+            if (!(error <= CHECK_TOLERANCE))
+            {
+                std::cerr << "Deep zoom check: the level " << downsampling << " times smaller than " << size.x << "x" << size.y << " differs from the full image averaged down by " << error << " per channel" << std::endl;
+                agree = false;
+            }
+        }
+
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteTextures(1, &texture);
+        return agree;
+    }
+
+    // Called on a writer thread with the pixels of `tiles[index]`
+    void writeFrame(int index, const unsigned char *rgb, int width, int height, std::vector<unsigned char> &scratch) override
+    {
+        const Tile &tile = tiles[index];
+        uint64_t contentHash = hashBytes(rgb, (size_t)width * height * 3);
+        std::string path = getPath(tile);
+
+        // A rerun with new settings may still produce the same pixels, the file is left alone so caches stay valid
+        bool unchanged;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto entry = manifest.find(getKey(tile));
+            unchanged = entry != manifest.end() && entry->second.contentHash == contentHash;
+        }
+        unchanged = unchanged && std::filesystem::exists(path);
+        if (!unchanged)
+        {
+            ImageWriter::encodePNG(scratch, rgb, width, height);
+            FILE *file = fopen(path.c_str(), "wb");
+            if (!file || fwrite(scratch.data(), 1, scratch.size(), file) != scratch.size())
+                std::cerr << "Could not write " << path << std::endl;
+            if (file) fclose(file);
+        }
+
+        // Appended as soon as the tile is on disk, so an interrupted run resumes from here
+        std::lock_guard<std::mutex> lock(mutex);
+        manifest[getKey(tile)] = { tile.settingsHash, contentHash };
+        if (unchanged) unchangedCount++;
+        if (manifestFile)
+        {
+            fprintf(manifestFile, "%d %d %d %016" PRIx64 " %016" PRIx64 "\n", tile.level, tile.column, tile.row, tile.settingsHash, contentHash);
+            fflush(manifestFile);
+        }
+    }
+
+private:
+
+    struct Tile
+    {
+        int level, column, row;
+        uint64_t settingsHash;  // Of the scene and everything else that decides the tile's pixels
+    };
+
+    struct ManifestEntry
+    {
+        uint64_t settingsHash, contentHash;
+    };
+
+    Renderer scene;
+    FrameWriter *frameWriter = nullptr;
+    GLuint FBOs[2], textures[2];
+    PixelReadback readback;  // The tag of every read is its index in `tiles`
+    glm::ivec2 size = glm::ivec2(0, 0);
+    int passesPerTile = 1;
+    int levelCount = 0;
+    std::string directory;
+    std::vector<Tile> tiles;  // Only the ones to render
+    int nextTile = 0;
+    int skippedCount = 0;
+    int unchangedCount = 0;
+    bool active = false;
+
+    std::unordered_map<uint64_t, ManifestEntry> manifest;
+    FILE *manifestFile = nullptr;
+    std::mutex mutex;
+
+    void queueTile(const PixelReadback::Frame &frame)
+    {
+        FrameWriter::Job *job = frameWriter->acquire();
+        job->width = frame.width;
+        job->height = frame.height;
+        job->pixels.assign(frame.pixels, frame.pixels + frame.width * frame.height * 3);
+        job->sink = this;
+        job->sinkFrame = frame.tag;
+
+        frameWriter->submit(job);
+    }
+
+    // One pass of the `tileSize` tile at `offset` of `scene`, read back as floats with the bottom row first. Empty if
+    // the scene shader doesn't build
+    static std::vector<glm::vec4> renderCheck(Renderer &scene, FullQuad &quad, GLuint fbo, GLuint texture, glm::ivec2 size, glm::ivec2 offset, glm::ivec2 tileSize, int downsampling)
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, tileSize.x, tileSize.y, 0, GL_RGBA, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+
+        if (!scene.drawPosterTile(quad, fbo, 0, size, offset, tileSize, 0, downsampling)) return {};
+
+        std::vector<glm::vec4> pixels((size_t)tileSize.x * tileSize.y);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glReadPixels(0, 0, tileSize.x, tileSize.y, GL_RGBA, GL_FLOAT, pixels.data());
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return pixels;
+    }
+
+    // Wait for the tiles in flight and rewrite the manifest with one line per tile
+    void finish()
+    {
+        readback.flush();
+        frameWriter->wait();
+        active = false;
+
+        if (manifestFile) fclose(manifestFile);
+        manifestFile = nullptr;
+
+        FILE *file = fopen((directory + "/manifest.txt").c_str(), "w");
+        if (!file) return;
+        for (const auto &[key, entry] : manifest)
+            fprintf(file, "%d %d %d %016" PRIx64 " %016" PRIx64 "\n", (int)(key >> 48), (int)(key >> 24 & 0xffffff), (int)(key & 0xffffff), entry.settingsHash, entry.contentHash);
+        fclose(file);
+    }
+
+    // Later lines win, so the appends of an interrupted run override what it started from
+    void readManifest()
+    {
+        manifest.clear();
+        unchangedCount = 0;
+
+        FILE *file = fopen((directory + "/manifest.txt").c_str(), "r");
+        if (!file) return;
+
+        Tile tile;
+        ManifestEntry entry;
+        while (fscanf(file, "%d %d %d %" SCNx64 " %" SCNx64, &tile.level, &tile.column, &tile.row, &entry.settingsHash, &entry.contentHash) == 5)
+            manifest[getKey(tile)] = entry;
+        fclose(file);
+    }
+
+    // Every level halves the one above it, rounding up, down to a single pixel at level 0
+    glm::ivec2 getLevelSize(int level) const
+    {
+        int downsampling = getDownsampling(level);
+        return (size + downsampling - 1) / downsampling;
+    }
+
+    // Pixels of the full image each way that one pixel of `level` covers
+    int getDownsampling(int level) const
+    {
+        return 1 << (levelCount - 1 - level);
+    }
+
+    // Pixels of the tile with its overlap as (x, y, width, height), with y counted from the top
+    glm::ivec4 getRect(const Tile &tile) const
+    {
+        glm::ivec2 levelSize = getLevelSize(tile.level);
+        glm::ivec2 from = glm::ivec2(tile.column, tile.row) * TILE_SIZE - glm::ivec2(tile.column > 0, tile.row > 0) * OVERLAP;
+        glm::ivec2 to = glm::min((glm::ivec2(tile.column, tile.row) + 1) * TILE_SIZE + OVERLAP, levelSize);
+        return glm::ivec4(from.x, from.y, to.x - from.x, to.y - from.y);
+    }
+
+    std::string getPath(const Tile &tile) const
+    {
+        return directory + "/" + std::to_string(tile.level) + "/" + std::to_string(tile.column) + "_" + std::to_string(tile.row) + ".png";
+    }
+
+    static uint64_t getKey(const Tile &tile)
+    {
+        return (uint64_t)tile.level << 48 | (uint64_t)tile.column << 24 | (uint64_t)tile.row;
+    }
+
+};
+
+#endif
@@ -0,0 +1,217 @@
+#ifndef DENOISER_H
+#define DENOISER_H
+
+#include <GL/glew.h>
+#include <math.h>
+#include <vector>
+#include <thread>
+#include <glm/glm.hpp>
+#include "imgui/imgui.h"
+#include "shader.h"
+#include "window.h"
+#include "fullQuad.h"
+
+// What the filter does, kept apart from the GL objects so saved frames can carry it to the writer threads
+struct DenoiseSettings
+{
+    int iterations = 2;
+    float sigmaColour = 0.4f;  // For a single pass, noise and so the tolerance shrink as passes accumulate
+    float sigmaNormal = 64.0f;
+    float sigmaDepth = 0.02f;
+};
+
+// Edge-avoiding à-trous wavelet filter guided by the normal and depth at every pixel
+class Denoiser
+{
+public:
+
+    bool enabled = false;
+    bool denoiseOnCPU = false;  // Filter saved images on worker threads instead of reading back the GPU result
+    DenoiseSettings settings;
+
+    Denoiser() {}
+
+    void init()
+    {
+        shader = Shader("quad.vert", "denoise.frag");
+        glGenFramebuffers(2, FBOs);
+        glGenTextures(2, textures);
+    }
+
+    // Filter the rendered corner of `colourTexture` into the denoiser's own textures, leaving the history untouched
+    void apply(FullQuad &quad, const Window &window, GLuint colourTexture, glm::ivec2 resolution, int passCount)
+    {
+        float passSigmaColour = settings.sigmaColour / sqrtf((float)glm::max(passCount, 1));
+
+        resize(window.resolution());
+
+        glDisable(GL_BLEND);
+        shader.use();
+        shader.setFloat("sigmaNormal", settings.sigmaNormal);
+        shader.setFloat("sigmaDepth", settings.sigmaDepth);
+        shader.setVec2i("resolution", resolution);
+        shader.setInt("colourTexture", 0);
+        shader.setInt("guideTexture", 1);
+
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, window.guideTexture);
+
+        for (int i = 0; i < settings.iterations; i++)
+        {
+            // Taps spread out and the colour tolerance shrinks every iteration
+            shader.setInt("stepWidth", 1 << i);
+            shader.setFloat("sigmaColour", passSigmaColour / (1 << i));
+
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, i == 0 ? colourTexture : textures[(i - 1) % 2]);
+            glBindFramebuffer(GL_FRAMEBUFFER, FBOs[i % 2]);
+            glViewport(0, 0, resolution.x, resolution.y);
+            quad.render();
+        }
+        output = (settings.iterations - 1) % 2;
+
+        // Unbind textures and FBO
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glEnable(GL_BLEND);
+    }
+
+    // Same filter on the CPU with `settings`, `colour` and `guide` hold `width`*`height` pixels with the bottom row first
+    static void apply(const DenoiseSettings &settings, std::vector<glm::vec3> &colour, const std::vector<glm::vec4> &guide, int width, int height, int passCount)
+    {
+        float passSigmaColour = settings.sigmaColour / sqrtf((float)glm::max(passCount, 1));
+        std::vector<glm::vec3> filtered(colour.size());
+        int threadCount = glm::max((int)std::thread::hardware_concurrency(), 1);
+
+        for (int i = 0; i < settings.iterations; i++)
+        {
+            // Every iteration reads the whole previous one, so the threads are joined in between
+            std::vector<std::thread> threads;
+            for (int t = 0; t < threadCount; t++)
+            {
+                int rowBegin = height * t / threadCount;
+                int rowEnd = height * (t + 1) / threadCount;
+                threads.emplace_back([&, i, rowBegin, rowEnd]() {
+                    filterRows(settings, colour, guide, filtered, width, height, 1 << i, passSigmaColour / (1 << i), rowBegin, rowEnd);
+                });
+            }
+            for (std::thread &thread : threads)
+                thread.join();
+
+            colour.swap(filtered);
+        }
+    }
+
+    GLuint getTexture() const
+    {
+        return textures[output];
+    }
+
+    GLuint getFBO() const
+    {
+        return FBOs[output];
+    }
+
+    bool menu()
+    {
+        bool updated = false;
+
+        updated |= ImGui::Checkbox("Denoise", &enabled);
+        if (enabled)
+        {
+            updated |= ImGui::SliderInt("Iterations", &settings.iterations, 1, 6);
+            updated |= ImGui::DragFloat("Colour sigma", &settings.sigmaColour, 0.01f, 0.01f, 10.0f, "%.2f");
+            updated |= ImGui::DragFloat("Normal sigma", &settings.sigmaNormal, 1.0f, 1.0f, 256.0f, "%.0f");
+            updated |= ImGui::DragFloat("Depth sigma", &settings.sigmaDepth, 0.001f, 0.001f, 1.0f, "%.3f");
+            ImGui::Checkbox("Denoise saved images on CPU", &denoiseOnCPU);
+        }
+
+        return updated;
+    }
+
+private:
+
+    Shader shader;
+    GLuint textures[2], FBOs[2];
+    glm::ivec2 size = glm::ivec2(0, 0);
+    int output = 0;
+
+    void resize(glm::ivec2 newSize)
+    {
+        if (newSize == size) return;
+        size = newSize;
+
+        // Half floats keep the intermediate iterations from banding
+        for (int i = 0; i < 2; i++)
+        {
+            glBindTexture(GL_TEXTURE_2D, textures[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, size.x, size.y, 0, GL_RGBA, GL_FLOAT, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, FBOs[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[i], 0);
+
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cerr << "Denoiser frame buffer not complete" << std::endl;
+        }
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // One iteration of the filter over rows [rowBegin, rowEnd), mirrors denoise.frag
+    static void filterRows(const DenoiseSettings &settings, const std::vector<glm::vec3> &colour, const std::vector<glm::vec4> &guide, std::vector<glm::vec3> &filtered,
+                           int width, int height, int stepWidth, float iterationSigmaColour, int rowBegin, int rowEnd)
+    {
+        static const float KERNEL[3] = { 3.0f/8.0f, 1.0f/4.0f, 1.0f/16.0f };
+
+        for (int py = rowBegin; py < rowEnd; py++)
+        {
+            for (int px = 0; px < width; px++)
+            {
+                const glm::vec3 &centreColour = colour[py*width + px];
+                const glm::vec4 &centreGuide = guide[py*width + px];
+
+                glm::vec3 sum(0.0f);
+                float weightSum = 0.0f;
+                for (int y = -2; y <= 2; y++)
+                {
+                    for (int x = -2; x <= 2; x++)
+                    {
+                        int tx = px + x*stepWidth, ty = py + y*stepWidth;
+                        if (tx < 0 || ty < 0 || tx >= width || ty >= height) continue;
+
+                        const glm::vec3 &tapColour = colour[ty*width + tx];
+                        const glm::vec4 &tapGuide = guide[ty*width + tx];
+
+                        // Never blend the surface with the background
+                        if ((centreGuide.w < 0.0f) != (tapGuide.w < 0.0f)) continue;
+
+                        glm::vec3 dc = tapColour - centreColour;
+                        float weight = KERNEL[abs(x)]*KERNEL[abs(y)] * expf(-glm::dot(dc, dc) / (iterationSigmaColour*iterationSigmaColour));
+
+                        // Edge stopping on creases and depth discontinuities
+                        if (centreGuide.w >= 0.0f)
+                        {
+                            float distance = sqrtf(float(x*x + y*y)) * stepWidth;
+                            weight *= powf(glm::max(glm::dot(glm::vec3(centreGuide), glm::vec3(tapGuide)), 0.0f), settings.sigmaNormal);
+                            weight *= expf(-fabsf(tapGuide.w - centreGuide.w) / (settings.sigmaDepth*centreGuide.w*distance + 1e-6f));
+                        }
+
+                        sum += weight*tapColour;
+                        weightSum += weight;
+                    }
+                }
+
+                filtered[py*width + px] = sum / weightSum;
+            }
+        }
+    }
+
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <math.h>
+#include <glm/glm.hpp>
+#include "imgui/imgui.h"
+
+// Lowers the render resolution while the user interacts with the scene to hold a target pass time
+class DynamicResolution
+{
+public:
+
+    bool enabled = false;
+    float targetMs = 8.0f;
+    float minScale = 0.25f;
+    float settleSeconds = 0.2f;
+
+    DynamicResolution() {}
+
+    // Returns the render scale to use this frame given the latest measured cost of a pass
+    float update(bool interacting, float passMs, double time)
+    {
+        if (interacting) lastInteractionTime = time;
+
+        // Go back to full resolution once input has stopped for a moment
+        if (!enabled || time - lastInteractionTime > settleSeconds)
+        {
+            scale = 1.0f;
+            return scale;
+        }
+
+        if (passMs > 0.0f)
+        {
+            // Pass cost scales with the pixel count, i.e. with the square of the scale
+            float idealScale = glm::clamp(scale * sqrtf(targetMs / passMs), minScale, 1.0f);
+
+            // Damp and quantise the change since the timing we measured lags behind the scale we set
+            float newScale = roundf(glm::mix(scale, idealScale, 0.5f) * 20.0f) / 20.0f;
+            scale = glm::clamp(newScale, minScale, 1.0f);
+        }
+
+        return scale;
+    }
+
+    void menu()
+    {
+        ImGui::Checkbox("Dynamic resolution", &enabled);
+        if (enabled)
+        {
+            ImGui::Text("Render scale: %.2f", scale);
+            ImGui::DragFloat("Target pass time (ms)", &targetMs, 0.1f, 1.0f, 100.0f, "%.1f");
+            ImGui::SliderFloat("Min scale", &minScale, 0.1f, 1.0f, "%.2f");
+        }
+    }
+
+private:
+
+    float scale = 1.0f;
+    double lastInteractionTime = -1.0e9;
+
+};
+
+#endif
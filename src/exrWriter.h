@@ -0,0 +1,131 @@
+#ifndef EXR_WRITER_H
+#define EXR_WRITER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <iostream>
+
+// Encodes float channels into an uncompressed scanline OpenEXR file, which every compositor reads
+class ExrWriter
+{
+public:
+
+    // `planes` holds `channelCount` planes of `width`*`height` floats with the bottom row first, in the order of
+    // `names`, which must be sorted as EXR requires
+    static void encode(std::vector<unsigned char> &out, const char *const *names, int channelCount, const float *planes, int width, int height)
+    {
+        out.clear();
+
+        // Magic number and version 2, single part scanline
+        pushInt(out, 20000630);
+        pushInt(out, 2);
+
+        // * Header
+        std::vector<unsigned char> channels;
+        for (int c = 0; c < channelCount; c++)
+        {
+            channels.insert(channels.end(), names[c], names[c] + strlen(names[c]) + 1);
+            pushInt(channels, 2);  // FLOAT
+            pushInt(channels, 0);  // pLinear and reserved bytes
+            pushInt(channels, 1);  // x and y sampling
+            pushInt(channels, 1);
+        }
+        channels.push_back(0);
+        pushAttribute(out, "channels", "chlist", channels);
+
+        pushAttribute(out, "compression", "compression", std::vector<unsigned char>(1, 0));
+
+        std::vector<unsigned char> window;
+        pushInt(window, 0);
+        pushInt(window, 0);
+        pushInt(window, width - 1);
+        pushInt(window, height - 1);
+        pushAttribute(out, "dataWindow", "box2i", window);
+        pushAttribute(out, "displayWindow", "box2i", window);
+
+        pushAttribute(out, "lineOrder", "lineOrder", std::vector<unsigned char>(1, 0));  // Increasing y, top row first
+
+        std::vector<unsigned char> value;
+        pushFloat(value, 1.0f);
+        pushAttribute(out, "pixelAspectRatio", "float", value);
+        pushAttribute(out, "screenWindowWidth", "float", value);
+
+        value.clear();
+        pushFloat(value, 0.0f);
+        pushFloat(value, 0.0f);
+        pushAttribute(out, "screenWindowCenter", "v2f", value);
+        out.push_back(0);
+
+        // * Offset table, then one block per scanline holding each channel's row in turn
+        size_t rowSize = (size_t)width * sizeof(float);
+        size_t blockSize = 8 + rowSize * channelCount;
+        size_t firstBlock = out.size() + (size_t)height * 8;
+        for (int y = 0; y < height; y++)
+            pushLong(out, firstBlock + blockSize * y);
+
+        size_t planeSize = (size_t)width * height;
+        out.resize(firstBlock + blockSize * height);
+        for (int y = 0; y < height; y++)
+        {
+            unsigned char *block = out.data() + firstBlock + blockSize * y;
+            int32_t header[2] = { y, (int32_t)(rowSize * channelCount) };
+            memcpy(block, header, 8);
+
+            // Little endian floats as stored, with the rows flipped
+            for (int c = 0; c < channelCount; c++)
+                memcpy(block + 8 + rowSize * c, planes + planeSize * c + (size_t)width * (height - 1 - y), rowSize);
+        }
+    }
+
+    static bool write(const std::string &path, const char *const *names, int channelCount, const float *planes, int width, int height, std::vector<unsigned char> &out)
+    {
+        encode(out, names, channelCount, planes, width, height);
+
+        std::string filename = path + ".exr";
+        FILE *file = fopen(filename.c_str(), "wb");
+        if (!file)
+        {
+            std::cerr << "Could not open " << filename << std::endl;
+            return false;
+        }
+
+        bool written = fwrite(out.data(), 1, out.size(), file) == out.size();
+        fclose(file);
+        return written;
+    }
+
+private:
+
+    // EXR is little endian throughout, like every machine this runs on
+    static void pushInt(std::vector<unsigned char> &out, int32_t value)
+    {
+        unsigned char *bytes = (unsigned char*)&value;
+        out.insert(out.end(), bytes, bytes + 4);
+    }
+
+    static void pushLong(std::vector<unsigned char> &out, uint64_t value)
+    {
+        unsigned char *bytes = (unsigned char*)&value;
+        out.insert(out.end(), bytes, bytes + 8);
+    }
+
+    static void pushFloat(std::vector<unsigned char> &out, float value)
+    {
+        unsigned char *bytes = (unsigned char*)&value;
+        out.insert(out.end(), bytes, bytes + 4);
+    }
+
+    static void pushAttribute(std::vector<unsigned char> &out, const char *name, const char *type, const std::vector<unsigned char> &value)
+    {
+        out.insert(out.end(), name, name + strlen(name) + 1);
+        out.insert(out.end(), type, type + strlen(type) + 1);
+        pushInt(out, (int32_t)value.size());
+        out.insert(out.end(), value.begin(), value.end());
+    }
+
+};
+
+#endif
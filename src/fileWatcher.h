@@ -0,0 +1,68 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+// Reports the files written in a directory through inotify, without ever blocking
+class FileWatcher
+{
+public:
+
+    FileWatcher() {}
+
+    bool init(const std::string &path)
+    {
+        stop();
+
+        // Editors that save by renaming a new file over the old one show up as a move into the directory
+        descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (descriptor == -1 || inotify_add_watch(descriptor, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) == -1)
+        {
+            std::cerr << "Could not watch " << path << " for changes" << std::endl;
+            stop();
+            return false;
+        }
+        return true;
+    }
+
+    void stop()
+    {
+        if (descriptor != -1) close(descriptor);
+        descriptor = -1;
+    }
+
+    // Names of the files written since the last call, each one once
+    std::vector<std::string> poll()
+    {
+        std::vector<std::string> changed;
+        if (descriptor == -1) return changed;
+
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length;
+        while ((length = read(descriptor, buffer, sizeof(buffer))) > 0)
+        {
+            const inotify_event *event;
+            for (char *next = buffer; next < buffer + length; next += sizeof(inotify_event) + event->len)
+            {
+                event = (const inotify_event*)next;
+                if (event->len == 0) continue;
+
+                std::string name = event->name;
+                if (std::find(changed.begin(), changed.end(), name) == changed.end()) changed.push_back(name);
+            }
+        }
+        return changed;
+    }
+
+private:
+
+    int descriptor = -1;
+
+};
+
+#endif
@@ -1,9 +1,11 @@
 #ifndef FRAME_INTERPOLATOR_H
 #define FRAME_INTERPOLATOR_H
 
+#include <stddef.h>
 #include <unordered_map>
 #include <iostream>
 #include <limits>
+#include "utils.h"
 
 class FrameInterpolator
 {
@@ -95,6 +97,28 @@ public:
         didInit = false;
     }
 
+    // Set every target with both ends to its initial value, as the first frame does
+    void applyInitialValues()
+    {
+        for (auto it = rangeMap.begin(); it != rangeMap.end(); it++)
+            updateValue(it->first, 0.0f);
+    }
+
+    // Of every target with both ends and its range. Targets are told apart by where they are in `base`, which holds
+    // them all, so the hash is the same from one run to the next
+    uint64_t hash(const void *base)
+    {
+        // The map's order isn't, so the entries are summed
+        uint64_t sum = 0;
+        for (auto it = rangeMap.begin(); it != rangeMap.end(); it++)
+        {
+            if (!isTargetActive(it->first)) continue;
+            ptrdiff_t offset = (const char*)it->first - (const char*)base;
+            sum += hashBytes(&it->second, sizeof(it->second), hashBytes(&offset, sizeof(offset)));
+        }
+        return sum;
+    }
+
 
     // * STATES
 
@@ -0,0 +1,216 @@
+#ifndef FRAME_SEQUENCE_H
+#define FRAME_SEQUENCE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include <mutex>
+#include <iostream>
+#include "frameSink.h"
+
+// A whole animation in one preallocated, memory mapped file: a header, an index with an entry per frame and a fixed
+// size slot per frame, so any frame is written, skipped or read back in O(1)
+class FrameSequence : public FrameSink
+{
+public:
+
+    FrameSequence() {}
+
+    ~FrameSequence()
+    {
+        close();
+    }
+
+    // Open the sequence at `path` if it holds frames of the same size and count, rendered from an animation with the
+    // same `animationHash`, otherwise create it. Frames already in an existing file are kept, which is what lets an
+    // interrupted export resume
+    bool open(const std::string &path, int width, int height, int frameCount, uint64_t animationHash)
+    {
+        close();
+
+        Header expected = {};
+        memcpy(expected.magic, MAGIC, sizeof(MAGIC));
+        expected.width = width;
+        expected.height = height;
+        expected.frameCount = frameCount;
+        expected.animationHash = animationHash;
+        expected.frameSize = (uint64_t)width * height * 3;
+        expected.slotSize = alignUp(expected.frameSize);
+        expected.dataOffset = alignUp(sizeof(Header) + (uint64_t)frameCount * sizeof(uint32_t));
+        uint64_t fileSize = expected.dataOffset + expected.slotSize * frameCount;
+
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+        {
+            std::cerr << "Could not open sequence " << path << std::endl;
+            return false;
+        }
+
+        Header existing = {};
+        bool resume = pread(fd, &existing, sizeof(Header), 0) == sizeof(Header) && memcmp(&existing, &expected, sizeof(Header)) == 0;
+        if (!resume)
+        {
+            if (memcmp(existing.magic, MAGIC, sizeof(MAGIC)) == 0)
+                std::cerr << "Sequence " << path << " holds frames of another animation, size or count, starting it over" << std::endl;
+
+            // Reserve every block now, running out of disk halfway through would fault on a mapped write instead
+            if (ftruncate(fd, 0) != 0 || posix_fallocate(fd, 0, fileSize) != 0)
+            {
+                std::cerr << "Could not allocate " << fileSize << " bytes for sequence " << path << std::endl;
+                close();
+                return false;
+            }
+        }
+
+        data = (unsigned char*)mmap(NULL, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            data = nullptr;
+            std::cerr << "Could not map sequence " << path << std::endl;
+            close();
+            return false;
+        }
+
+        // A fresh file reads as zeros, so every frame starts out missing
+        mappedSize = fileSize;
+        header = expected;
+        if (!resume) memcpy(data, &header, sizeof(Header));
+        index = (uint32_t*)(data + sizeof(Header));
+
+        writtenCount = 0;
+        for (int i = 0; i < frameCount; i++)
+            writtenCount += index[i] != 0;
+
+        return true;
+    }
+
+    void close()
+    {
+        if (data)
+        {
+            msync(data, mappedSize, MS_SYNC);
+            munmap(data, mappedSize);
+            data = nullptr;
+            index = nullptr;
+        }
+        if (fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    // Copy `rgb` into the frame's slot, bottom row first as read from OpenGL. Safe to call from several threads for
+    // different frames
+    void write(int frame, const unsigned char *rgb)
+    {
+        if (!isValid(frame)) return;
+
+        // The pixels reach the disk before the index says they're there, so a crash never leaves a torn frame marked written
+        unsigned char *slot = data + header.dataOffset + header.slotSize * frame;
+        memcpy(slot, rgb, header.frameSize);
+        msync(slot, header.slotSize, MS_SYNC);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (index[frame] == 0) writtenCount++;
+        index[frame] = 1;
+    }
+
+    void writeFrame(int frame, const unsigned char *rgb, int width, int height, std::vector<unsigned char> &scratch) override
+    {
+        write(frame, rgb);
+    }
+
+    // Forget a frame so it's rendered again, its old pixels stay until then
+    void erase(int frame)
+    {
+        if (!isValid(frame)) return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (index[frame] != 0) writtenCount--;
+        index[frame] = 0;
+    }
+
+    bool hasFrame(int frame)
+    {
+        if (!isValid(frame)) return false;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        return index[frame] != 0;
+    }
+
+    // Pixels of a written frame, or nullptr
+    const unsigned char *read(int frame)
+    {
+        return hasFrame(frame) ? data + header.dataOffset + header.slotSize * frame : nullptr;
+    }
+
+    bool isOpen() const
+    {
+        return data != nullptr;
+    }
+
+    int getWidth() const
+    {
+        return header.width;
+    }
+
+    int getHeight() const
+    {
+        return header.height;
+    }
+
+    int getFrameCount() const
+    {
+        return header.frameCount;
+    }
+
+    int getWrittenCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return writtenCount;
+    }
+
+private:
+
+    static constexpr char MAGIC[8] = { 'J', 'U', 'L', 'I', 'A', 'S', 'E', 'Q' };
+
+    // Stored at the start of the file, a file is only resumed if this matches exactly
+    struct Header
+    {
+        char magic[8];
+        uint32_t width, height;
+        uint32_t frameCount;
+        uint32_t reserved;
+        uint64_t frameSize;   // Packed RGB
+        uint64_t slotSize;    // Frame size rounded up to whole pages
+        uint64_t dataOffset;  // Of the first slot, after the index of one word per frame
+        uint64_t animationHash;  // Of the keyframes and scene settings the frames are rendered from
+    };
+
+    Header header = {};
+    int fd = -1;
+    unsigned char *data = nullptr;
+    uint64_t mappedSize = 0;
+    uint32_t *index = nullptr;  // Non-zero once a frame is written
+    int writtenCount = 0;
+    std::mutex mutex;
+
+    bool isValid(int frame) const
+    {
+        return data && frame >= 0 && frame < (int)header.frameCount;
+    }
+
+    static uint64_t alignUp(uint64_t size)
+    {
+        uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+        return (size + page - 1) / page * page;
+    }
+
+};
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef FRAME_SINK_H
+#define FRAME_SINK_H
+
+#include <vector>
+
+// Somewhere a `FrameWriter` job goes instead of an image file of its own, called on the writer threads
+class FrameSink
+{
+public:
+
+    virtual ~FrameSink() {}
+
+    // `rgb` holds `width`*`height` pixels with the bottom row first, `scratch` is the worker's to encode into
+    virtual void writeFrame(int frame, const unsigned char *rgb, int width, int height, std::vector<unsigned char> &scratch) = 0;
+
+};
+
+#endif
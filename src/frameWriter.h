@@ -0,0 +1,179 @@
+#ifndef FRAME_WRITER_H
+#define FRAME_WRITER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <glm/glm.hpp>
+#include "imageWriter.h"
+#include "denoiser.h"
+#include "frameSink.h"
+#include "exrWriter.h"
+#include "layerExport.h"
+
+// Encodes and writes frames on a pool of worker threads so exports never wait on the disk
+class FrameWriter
+{
+public:
+
+    // A frame waiting to be written, its buffers are reused from one frame to the next
+    struct Job
+    {
+        std::string path;
+        int width = 0, height = 0;
+        int format = 0;
+        std::vector<unsigned char> pixels;  // RGB with the bottom row first
+        std::vector<glm::vec4> guide;       // Empty unless the frame is denoised on the CPU
+        int passCount = 1;
+        DenoiseSettings denoiseSettings;    // At the time the frame was saved
+        FrameSink *sink = nullptr;          // Given the frame instead of writing a file
+        int sinkFrame = 0;
+        std::vector<float> layers;          // Planes of `LayerExport`, written as an EXR instead of `pixels` if not empty
+    };
+
+    FrameWriter() {}
+
+    ~FrameWriter()
+    {
+        stop();
+    }
+
+    // At most `queueCapacity` frames wait to be written, after that `acquire` blocks the render thread
+    void start(int workerCount, int queueCapacity)
+    {
+        jobs.resize(workerCount + queueCapacity);
+        queue.resize(jobs.size());
+        for (Job &job : jobs)
+            freeJobs.push_back(&job);
+
+        stopping = false;
+        for (int i = 0; i < workerCount; i++)
+            workers.emplace_back([this]() { work(); });
+    }
+
+    // Write every queued frame and join the workers
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        queueCondition.notify_all();
+
+        for (std::thread &worker : workers)
+            worker.join();
+        workers.clear();
+    }
+
+    // Take a free job to fill in, waiting while every one is queued or being written. It's cleared of whatever kind of
+    // frame it last wrote, but keeps its buffers
+    Job *acquire()
+    {
+        Job *job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            freeCondition.wait(lock, [this]() { return !freeJobs.empty(); });
+
+            job = freeJobs.back();
+            freeJobs.pop_back();
+        }
+
+        job->guide.clear();
+        job->layers.clear();
+        job->sink = nullptr;
+        return job;
+    }
+
+    void submit(Job *job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue[(queueHead + queueCount) % queue.size()] = job;
+            queueCount++;
+        }
+        queueCondition.notify_one();
+    }
+
+    // Block until every queued frame is written
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        freeCondition.wait(lock, [this]() { return freeJobs.size() == jobs.size(); });
+    }
+
+    // Frames queued or being written
+    int getPending()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return (int)(jobs.size() - freeJobs.size());
+    }
+
+private:
+
+    std::deque<Job> jobs;  // Never resized once started, so the pointers stay valid
+    std::vector<Job*> freeJobs;
+    std::vector<Job*> queue;  // Ring with room for every job, so submitting never allocates or blocks
+    int queueHead = 0;
+    int queueCount = 0;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable queueCondition, freeCondition;
+    bool stopping = false;
+
+    void work()
+    {
+        // Scratch buffers of this worker, also reused across frames
+        std::vector<unsigned char> encoded;
+        std::vector<glm::vec3> colour;
+
+        while (true)
+        {
+            Job *job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                queueCondition.wait(lock, [this]() { return stopping || queueCount > 0; });
+                if (queueCount == 0) return;
+
+                job = queue[queueHead];
+                queueHead = (queueHead + 1) % queue.size();
+                queueCount--;
+            }
+
+            if (!job->guide.empty()) denoise(*job, colour);
+            if (!job->layers.empty())
+                ExrWriter::write(job->path, LayerExport::CHANNELS, LayerExport::CHANNEL_COUNT, job->layers.data(), job->width, job->height, encoded);
+            else if (job->sink) job->sink->writeFrame(job->sinkFrame, job->pixels.data(), job->width, job->height, encoded);
+            else ImageWriter::write(job->format, job->path, job->pixels.data(), job->width, job->height, encoded);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                freeJobs.push_back(job);
+            }
+            freeCondition.notify_all();
+        }
+    }
+
+    void denoise(Job &job, std::vector<glm::vec3> &colour)
+    {
+        int pixelCount = job.width * job.height;
+        colour.resize(pixelCount);
+        for (int i = 0; i < pixelCount; i++)
+            colour[i] = glm::vec3(job.pixels[i*3], job.pixels[i*3 + 1], job.pixels[i*3 + 2]) / 255.0f;
+
+        Denoiser::apply(job.denoiseSettings, colour, job.guide, job.width, job.height, job.passCount);
+
+        for (int i = 0; i < pixelCount; i++)
+        {
+            glm::vec3 rgb = glm::clamp(colour[i], 0.0f, 1.0f) * 255.0f + 0.5f;
+            job.pixels[i*3] = (unsigned char)rgb.x;
+            job.pixels[i*3 + 1] = (unsigned char)rgb.y;
+            job.pixels[i*3 + 2] = (unsigned char)rgb.z;
+        }
+    }
+
+};
+
+#endif
@@ -14,7 +14,7 @@ public:
 
     void init()
     {
-        shader = Shader("./src/shaders/quad.vert", "./src/shaders/quad.frag");
+        shader = Shader("quad.vert", "quad.frag");
 
         // Vertex data for a full-screen quad
         float quadVertices[] = {
@@ -0,0 +1,60 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <GL/glew.h>
+
+class GpuTimer
+{
+public:
+
+    static constexpr int QUERY_COUNT = 4;
+
+    GpuTimer() {}
+
+    void init()
+    {
+        glGenQueries(QUERY_COUNT, queries);
+    }
+
+    // Returns false if every query is still in flight, in which case nothing is timed
+    bool begin()
+    {
+        if (pending == QUERY_COUNT) return false;
+
+        glBeginQuery(GL_TIME_ELAPSED, queries[head]);
+        return true;
+    }
+
+    void end()
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        head = (head + 1) % QUERY_COUNT;
+        pending++;
+    }
+
+    // Reads back the oldest query if the GPU is done with it, never blocks
+    bool poll(float *milliseconds)
+    {
+        if (pending == 0) return false;
+
+        int tail = (head - pending + QUERY_COUNT) % QUERY_COUNT;
+        GLint available = 0;
+        glGetQueryObjectiv(queries[tail], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return false;
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(queries[tail], GL_QUERY_RESULT, &nanoseconds);
+        *milliseconds = nanoseconds / 1.0e6f;
+        pending--;
+        return true;
+    }
+
+private:
+
+    GLuint queries[QUERY_COUNT];
+    int head = 0;
+    int pending = 0;
+
+};
+
+#endif
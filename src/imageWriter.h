@@ -0,0 +1,267 @@
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <iostream>
+#include <zlib.h>
+
+// Encodes RGB frames, read straight from OpenGL with the bottom row first, into image files
+class ImageWriter
+{
+public:
+
+    enum Format { P6 = 0, QOI = 1, PNG = 2, FORMAT_COUNT = 3 };
+
+    typedef void (*EncodeFunction)(std::vector<unsigned char> &out, const unsigned char *rgb, int width, int height);
+
+    struct Encoder
+    {
+        const char *name;
+        const char *extension;
+        EncodeFunction encode;
+    };
+
+    // Every supported format, indexed by `Format`
+    static const Encoder &encoder(int format)
+    {
+        static const Encoder ENCODERS[FORMAT_COUNT] = {
+            { "PPM (P6)", ".ppm", encodeP6 },
+            { "QOI", ".qoi", encodeQOI },
+            { "PNG", ".png", encodePNG },
+        };
+        return ENCODERS[format];
+    }
+
+    // Encode `rgb` into `out` and write it to `path` followed by the format's extension
+    static bool write(int format, const std::string &path, const unsigned char *rgb, int width, int height, std::vector<unsigned char> &out)
+    {
+        encoder(format).encode(out, rgb, width, height);
+
+        std::string filename = path + encoder(format).extension;
+        FILE *file = fopen(filename.c_str(), "wb");
+        if (!file)
+        {
+            std::cerr << "Could not open " << filename << std::endl;
+            return false;
+        }
+
+        bool written = fwrite(out.data(), 1, out.size(), file) == out.size();
+        fclose(file);
+        return written;
+    }
+
+
+    // * Encoders
+
+    static void encodeP6(std::vector<unsigned char> &out, const unsigned char *rgb, int width, int height)
+    {
+        char header[64];
+        int headerSize = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+        size_t rowSize = (size_t)width * 3;
+
+        // The flip is just copying the rows in reverse order
+        out.resize(headerSize + rowSize * height);
+        memcpy(out.data(), header, headerSize);
+        for (int y = 0; y < height; y++)
+            memcpy(out.data() + headerSize + rowSize * y, rgb + rowSize * (height - 1 - y), rowSize);
+    }
+
+    static void encodeQOI(std::vector<unsigned char> &out, const unsigned char *rgb, int width, int height)
+    {
+        out.clear();
+        out.reserve(14 + (size_t)width * height * 4 + 8);
+
+        // Header: magic, big endian size, 3 channels, sRGB
+        const unsigned char magic[4] = { 'q', 'o', 'i', 'f' };
+        out.insert(out.end(), magic, magic + 4);
+        pushBigEndian(out, width);
+        pushBigEndian(out, height);
+        out.push_back(3);
+        out.push_back(0);
+
+        // Entries start out transparent black, which no opaque pixel matches
+        unsigned char index[64][4] = {};
+        unsigned char prev[3] = { 0, 0, 0 };
+        int run = 0;
+
+        for (int y = height - 1; y >= 0; y--)
+        {
+            const unsigned char *row = rgb + (size_t)width * 3 * y;
+            for (int x = 0; x < width; x++)
+            {
+                const unsigned char *px = row + x*3;
+                bool last = y == 0 && x == width - 1;
+
+                if (px[0] == prev[0] && px[1] == prev[1] && px[2] == prev[2])
+                {
+                    if (++run == 62 || last)
+                    {
+                        out.push_back(0xc0 | (run - 1));  // QOI_OP_RUN
+                        run = 0;
+                    }
+                    continue;
+                }
+
+                if (run > 0)
+                {
+                    out.push_back(0xc0 | (run - 1));
+                    run = 0;
+                }
+
+                // Alpha is always 255, which adds 255*11 to the hash
+                int hash = (px[0]*3 + px[1]*5 + px[2]*7 + 255*11) % 64;
+                if (index[hash][0] == px[0] && index[hash][1] == px[1] && index[hash][2] == px[2] && index[hash][3] == 255)
+                {
+                    out.push_back(hash);  // QOI_OP_INDEX
+                }
+                else
+                {
+                    memcpy(index[hash], px, 3);
+                    index[hash][3] = 255;
+
+                    signed char dr = px[0] - prev[0];
+                    signed char dg = px[1] - prev[1];
+                    signed char db = px[2] - prev[2];
+                    signed char dr_dg = dr - dg;
+                    signed char db_dg = db - dg;
+
+                    if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                    {
+                        out.push_back(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));  // QOI_OP_DIFF
+                    }
+                    else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7)
+                    {
+                        out.push_back(0x80 | (dg + 32));  // QOI_OP_LUMA
+                        out.push_back((dr_dg + 8) << 4 | (db_dg + 8));
+                    }
+                    else
+                    {
+                        out.push_back(0xfe);  // QOI_OP_RGB
+                        out.insert(out.end(), px, px + 3);
+                    }
+                }
+
+                memcpy(prev, px, 3);
+            }
+        }
+
+        const unsigned char padding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+        out.insert(out.end(), padding, padding + 8);
+    }
+
+    static void encodePNG(std::vector<unsigned char> &out, const unsigned char *rgb, int width, int height)
+    {
+        // Rows are filtered and deflated in independent stripes, one per thread
+        int stripeCount = std::max(std::min((int)std::thread::hardware_concurrency(), height / 32), 1);
+        std::vector<std::vector<unsigned char>> stripes(stripeCount);
+        std::vector<uLong> adlers(stripeCount);
+        std::vector<uLong> rawSizes(stripeCount);
+
+        std::vector<std::thread> threads;
+        for (int s = 0; s < stripeCount; s++)
+        {
+            threads.emplace_back([&, s]() {
+                int rowBegin = height * s / stripeCount;
+                int rowEnd = height * (s + 1) / stripeCount;
+                deflateStripe(stripes[s], &adlers[s], &rawSizes[s], rgb, width, height, rowBegin, rowEnd, s == stripeCount - 1);
+            });
+        }
+        for (std::thread &thread : threads)
+            thread.join();
+
+        out.clear();
+        const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+        out.insert(out.end(), signature, signature + 8);
+
+        // 8 bit RGB, no interlacing
+        std::vector<unsigned char> header;
+        pushBigEndian(header, width);
+        pushBigEndian(header, height);
+        const unsigned char format[5] = { 8, 2, 0, 0, 0 };
+        header.insert(header.end(), format, format + 5);
+        pushChunk(out, "IHDR", header.data(), header.size());
+
+        // The stripes end byte aligned without a final block, so they concatenate into one zlib stream
+        std::vector<unsigned char> data = { 0x78, 0x01 };
+        uLong adler = adler32(0L, Z_NULL, 0);
+        for (int s = 0; s < stripeCount; s++)
+        {
+            data.insert(data.end(), stripes[s].begin(), stripes[s].end());
+            adler = adler32_combine(adler, adlers[s], rawSizes[s]);
+        }
+        pushBigEndian(data, (unsigned int)adler);
+        pushChunk(out, "IDAT", data.data(), data.size());
+        pushChunk(out, "IEND", NULL, 0);
+    }
+
+private:
+
+    static void pushBigEndian(std::vector<unsigned char> &out, unsigned int value)
+    {
+        out.push_back(value >> 24);
+        out.push_back(value >> 16);
+        out.push_back(value >> 8);
+        out.push_back(value);
+    }
+
+    static void pushChunk(std::vector<unsigned char> &out, const char *type, const unsigned char *data, size_t size)
+    {
+        pushBigEndian(out, (unsigned int)size);
+        size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        if (size > 0) out.insert(out.end(), data, data + size);
+        pushBigEndian(out, (unsigned int)crc32(0L, out.data() + start, (uInt)(out.size() - start)));
+    }
+
+    // Filter rows [rowBegin, rowEnd) of the top-first image and deflate them as a raw deflate fragment
+    static void deflateStripe(std::vector<unsigned char> &out, uLong *adler, uLong *rawSize, const unsigned char *rgb,
+                              int width, int height, int rowBegin, int rowEnd, bool last)
+    {
+        size_t rowSize = (size_t)width * 3;
+        std::vector<unsigned char> raw((rowSize + 1) * (rowEnd - rowBegin));
+
+        for (int y = rowBegin; y < rowEnd; y++)
+        {
+            // Image row y is stored at height - 1 - y, and the row above it one further up in memory
+            const unsigned char *row = rgb + rowSize * (height - 1 - y);
+            const unsigned char *up = y > 0 ? row + rowSize : NULL;
+            unsigned char *filtered = raw.data() + (rowSize + 1) * (y - rowBegin);
+
+            // Paeth filter, it only reads unfiltered rows so stripes don't depend on each other
+            filtered[0] = 4;
+            for (size_t i = 0; i < rowSize; i++)
+            {
+                int a = i >= 3 ? row[i - 3] : 0;
+                int b = up ? up[i] : 0;
+                int c = up && i >= 3 ? up[i - 3] : 0;
+                int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+                int predictor = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+                filtered[i + 1] = row[i] - predictor;
+            }
+        }
+
+        *adler = adler32(adler32(0L, Z_NULL, 0), raw.data(), (uInt)raw.size());
+        *rawSize = raw.size();
+
+        // Raw deflate, a sync flush ends the stripe on a byte boundary without marking the stream finished
+        z_stream stream = {};
+        deflateInit2(&stream, 3, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+        out.resize(deflateBound(&stream, raw.size()) + 16);
+        stream.next_in = raw.data();
+        stream.avail_in = (uInt)raw.size();
+        stream.next_out = out.data();
+        stream.avail_out = (uInt)out.size();
+        deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+        out.resize(stream.total_out);
+        deflateEnd(&stream);
+    }
+
+};
+
+#endif
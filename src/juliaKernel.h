@@ -0,0 +1,35 @@
+#ifndef JULIA_KERNEL_H
+#define JULIA_KERNEL_H
+
+#include <math.h>
+#include <glm/glm.hpp>
+#include "utils.h"
+
+// The parts of the scene shader compiled as C++ from the same files, so the CPU and the GPU can't drift apart. The
+// files keep to the GLSL that glm also compiles: no swizzles, float literals suffixed with f, no structs built with
+// constructors, and INOUT(type) for the parameters written to
+namespace glsl
+{
+    using namespace glm;
+
+    struct JuliaKernel
+    {
+        // The uniforms the kernel reads, as the renderer fills them into FractalBlock
+        vec4 c = vec4(-0.2f, 0.6f, 0.2f, 0.2f);
+        int maxIterations = 10;
+        float boundingRadius2 = 9.0f;
+        float escapeThreshold = 100.0f;
+
+        // * Kernel
+        #define INOUT(type) type&
+        #include "shaders/ray.glsl"
+        #include "shaders/quaternion.glsl"
+        #include "shaders/fractal.glsl"
+        #include "shaders/brdf.glsl"
+        #undef INOUT
+    };
+}
+
+using glsl::JuliaKernel;
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef KERNEL_CHECK_H
+#define KERNEL_CHECK_H
+
+#include <GL/glew.h>
+#include <math.h>
+#include <random>
+#include <vector>
+#include <iostream>
+#include <glm/glm.hpp>
+#include "shader.h"
+#include "fullQuad.h"
+#include "juliaKernel.h"
+
+// Evaluates the kernel shared by the shaders and the CPU on both, for the same inputs, and reports every function
+// whose results disagree. Debug builds run it after building and fail if they disagree, so a change that only
+// compiles in one language shows up
+class KernelCheck
+{
+public:
+
+    static constexpr int CASES = 64;
+    static constexpr int ROWS = 4;
+    static constexpr float TOLERANCE = 1e-3f;  // Relative to the CPU's result, or absolute below 1
+
+    // True if both agree, the functions that don't are printed
+    static bool run(FullQuad &quad)
+    {
+        JuliaKernel kernel;
+
+        // Quaternions and directions spread around the bounding sphere, the same every run
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> coordinate(-1.5f, 1.5f);
+        std::vector<glm::vec4> inputs(2*CASES);
+        for (glm::vec4 &input : inputs) input = glm::vec4(coordinate(random), coordinate(random), coordinate(random), coordinate(random));
+
+        std::vector<glm::vec4> results = evaluateGPU(kernel, quad, inputs);
+
+        bool agree = true;
+        for (int row = 0; row < ROWS; row++)
+        {
+            for (int component = 0; component < 4; component++)
+            {
+                // The worst case of each function
+                int mismatches = 0, worst = 0;
+                float worstError = 0.0f, worstCPU = 0.0f;
+                for (int i = 0; i < CASES; i++)
+                {
+                    float cpu = evaluate(kernel, row, inputs[i], inputs[CASES + i])[component];
+                    float gpu = results[row*CASES + i][component];
+                    float error = fabsf(gpu - cpu) / glm::max(fabsf(cpu), 1.0f);
+                    if (!(error <= TOLERANCE))
+                    {
+                        mismatches++;
+                        if (!(error <= worstError)) worst = i, worstError = error, worstCPU = cpu;
+                    }
+                }
+
+                if (mismatches)
+                {
+                    std::cerr << "Kernel check: " << FUNCTION_NAMES[row][component] << " differs in " << mismatches << " of " << CASES << " cases, worst is case " << worst
+                              << " with " << worstCPU << " on the CPU and " << results[row*CASES + worst][component] << " on the GPU" << std::endl;
+                    agree = false;
+                }
+            }
+        }
+        return agree;
+    }
+
+    // Row `row` of the check for inputs `a` and `b`, keep in step with kernelCheck.frag
+    static glm::vec4 evaluate(JuliaKernel &kernel, int row, glm::vec4 a, glm::vec4 b)
+    {
+        if (row == 0) return kernel.qSquare(a);
+        if (row == 1) return kernel.qMultiply(a, b);
+        if (row == 2)
+        {
+            JuliaKernel::Ray ray = { 2.0f*glm::vec3(a), glm::vec3(b) };  // Far enough out to miss the bounding sphere too
+            return glm::vec4(kernel.juliaDistanceEstimate(a, b), kernel.juliaDistance(glm::vec3(a), a.w), kernel.hitSphere(ray), kernel.exitSphere(ray));
+        }
+
+        glm::vec3 N = glm::normalize(glm::vec3(a));
+        glm::vec3 V = glm::normalize(glm::vec3(b));
+        glm::vec3 L = glm::normalize(glm::vec3(a.w, b.w, 1.0f));
+        glm::vec3 H = glm::normalize(V + L);
+        float NdotV = glm::max(glm::dot(N, V), 0.0f);
+        float HdotV = glm::max(glm::dot(H, V), 0.0f);
+        return glm::vec4(kernel.DistributionGGX(N, H, 0.3f), kernel.GeometrySmith(N, V, L, 0.2f), kernel.GeometrySchlickGGX(NdotV, 0.2f), kernel.fresnelSchlick(HdotV, glm::vec3(0.04f, 0.5f, 0.9f)).z);
+    }
+
+private:
+
+    static constexpr const char *FUNCTION_NAMES[ROWS][4] = {
+        { "qSquare.x", "qSquare.y", "qSquare.z", "qSquare.w" },
+        { "qMultiply.x", "qMultiply.y", "qMultiply.z", "qMultiply.w" },
+        { "juliaDistanceEstimate", "juliaDistance", "hitSphere", "exitSphere" },
+        { "DistributionGGX", "GeometrySmith", "GeometrySchlickGGX", "fresnelSchlick" }
+    };
+
+    // Every row for every case, drawn into a float target and read back row by row
+    static std::vector<glm::vec4> evaluateGPU(JuliaKernel &kernel, FullQuad &quad, const std::vector<glm::vec4> &inputs)
+    {
+        GLuint textures[2], FBO;
+        glGenTextures(2, textures);
+        glBindTexture(GL_TEXTURE_2D, textures[0]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, CASES, 2, 0, GL_RGBA, GL_FLOAT, inputs.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, textures[1]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, CASES, ROWS, 0, GL_RGBA, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[1], 0);
+
+        Shader shader("quad.vert", "kernelCheck.frag");
+        shader.use();
+        shader.setInt("inputs", 0);
+        shader.setVec4f("c", kernel.c);
+        shader.setInt("maxIterations", kernel.maxIterations);
+        shader.setFloat("boundingRadius2", kernel.boundingRadius2);
+        shader.setFloat("escapeThreshold", kernel.escapeThreshold);
+
+        // Blending would mix the results with whatever the target held
+        GLboolean blend = glIsEnabled(GL_BLEND);
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glDisable(GL_BLEND);
+        glViewport(0, 0, CASES, ROWS);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, textures[0]);
+        quad.render();
+
+        std::vector<glm::vec4> results(CASES*ROWS);
+        glReadPixels(0, 0, CASES, ROWS, GL_RGBA, GL_FLOAT, results.data());
+
+        // Cleanup
+        if (blend) glEnable(GL_BLEND);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteTextures(2, textures);
+        glDeleteProgram(shader.getID());
+
+        return results;
+    }
+
+};
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef LAYER_EXPORT_H
+#define LAYER_EXPORT_H
+
+#include <GL/glew.h>
+#include <math.h>
+#include <vector>
+#include <iostream>
+#include <glm/glm.hpp>
+#include "renderer.h"
+#include "fullQuad.h"
+
+// Renders every pass a compositor needs from the image on screen, and reads them back as float planes
+class LayerExport
+{
+public:
+
+    // EXR channel names in the order of the planes, sorted as EXR requires. A is the hit mask, the fraction of samples
+    // that hit the surface, and the colour is premultiplied by it
+    static constexpr int CHANNEL_COUNT = 9;
+    static constexpr const char *CHANNELS[CHANNEL_COUNT] = { "A", "B", "G", "N.X", "N.Y", "N.Z", "R", "Z", "iterations" };
+
+    LayerExport() {}
+
+    void init()
+    {
+        glGenFramebuffers(1, &FBO);
+        glGenTextures(3, textures);
+    }
+
+    // Render the layers of the last pass, they're sized to its resolution. With TAA they average as many passes as its
+    // image, up to Renderer::MAX_LAYER_PASSES. False if the scene shader doesn't build for them
+    bool capture(Renderer &renderer, FullQuad &quad)
+    {
+        resize(renderer.getLastPassResolution());
+        return renderer.drawLayers(quad, FBO);
+    }
+
+    // Read the captured layers into `planes`, one plane of `getSize` floats per channel with the bottom row first
+    void read(std::vector<float> &planes)
+    {
+        size_t pixelCount = (size_t)size.x * size.y;
+        colour.resize(pixelCount);
+        gBuffer.resize(pixelCount);
+        planes.resize(pixelCount * CHANNEL_COUNT);
+        float *iterations = planes.data() + pixelCount * 8;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_FLOAT, colour.data());
+        glReadBuffer(GL_COLOR_ATTACHMENT1);
+        glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_FLOAT, gBuffer.data());
+        glReadBuffer(GL_COLOR_ATTACHMENT2);
+        glReadPixels(0, 0, size.x, size.y, GL_RED, GL_FLOAT, iterations);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        for (size_t i = 0; i < pixelCount; i++)
+        {
+            // Misses are infinitely far away
+            bool hit = gBuffer[i].w >= 0.0f;
+            float values[8] = { colour[i].w, colour[i].z, colour[i].y, gBuffer[i].x, gBuffer[i].y, gBuffer[i].z, colour[i].x, hit ? gBuffer[i].w : INFINITY };
+            for (int c = 0; c < 8; c++)
+                planes[pixelCount * c + i] = values[c];
+        }
+    }
+
+    glm::ivec2 getSize() const
+    {
+        return size;
+    }
+
+private:
+
+    GLuint FBO;
+    GLuint textures[3];  // Colour and coverage, normal and depth, iterations
+    glm::ivec2 size = glm::ivec2(0, 0);
+    std::vector<glm::vec4> colour, gBuffer;
+
+    void resize(glm::ivec2 newSize)
+    {
+        if (newSize == size) return;
+        size = newSize;
+
+        const GLenum formats[3] = { GL_RGBA32F, GL_RGBA32F, GL_R32F };
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        for (int i = 0; i < 3; i++)
+        {
+            glBindTexture(GL_TEXTURE_2D, textures[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, formats[i], size.x, size.y, 0, i == 2 ? GL_RED : GL_RGBA, GL_FLOAT, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, textures[i], 0);
+        }
+
+        const GLenum drawBuffers[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+        glDrawBuffers(3, drawBuffers);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "Layer frame buffer not complete" << std::endl;
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+};
+
+#endif
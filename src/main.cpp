@@ -1,9 +1,30 @@
 #include <iostream>
+#include <string>
 #include "app.h"
 
-int main()
+int main(int argc, char **argv)
 {
     App app(1700, 900);
+
+    // `--bench-uniforms` prints how long the uniforms of a pass take to set and exits
+    if (argc > 1 && std::string(argv[1]) == "--bench-uniforms")
+    {
+        app.benchUniforms();
+        return 0;
+    }
+
+    // `--check-kernel` exits with an error if the CPU and GPU copies of the kernel disagree, debug builds run it
+    if (argc > 1 && std::string(argv[1]) == "--check-kernel")
+    {
+        return app.checkKernel() ? 0 : 1;
+    }
+
+    // `--check-deep-zoom` exits with an error if a level of a pyramid is framed differently from the full image
+    if (argc > 1 && std::string(argv[1]) == "--check-deep-zoom")
+    {
+        return app.checkDeepZoom() ? 0 : 1;
+    }
+
     app.loop();
     
     return 0;
@@ -0,0 +1,159 @@
+#ifndef PIXEL_READBACK_H
+#define PIXEL_READBACK_H
+
+#include <GL/glew.h>
+#include <string>
+#include <iostream>
+#include <functional>
+#include <glm/glm.hpp>
+
+// Reads frames back through a ring of pixel pack buffers so the GPU never waits on the CPU
+class PixelReadback
+{
+public:
+
+    static constexpr int BUFFER_COUNT = 4;
+
+    // A finished read, `pixels` is tightly packed in the requested format and `guide` the optional G-buffer, both with the bottom row first
+    struct Frame
+    {
+        int width, height;
+        std::string name;
+        int tag;  // Whatever the caller passed along with the request
+        const unsigned char *pixels;
+        const glm::vec4 *guide;
+    };
+
+    PixelReadback() {}
+
+    void init(std::function<void(const Frame &)> onFrame)
+    {
+        callback = onFrame;
+        glGenBuffers(BUFFER_COUNT, buffers);
+    }
+
+    // Queue a read of `fbo`, and of the guide if `guideFBO` isn't 0. Only waits if every buffer is still in flight
+    void request(GLuint fbo, GLuint guideFBO, int width, int height, const std::string &name, int tag = 0, GLenum format = GL_RGB)
+    {
+        if (pending == BUFFER_COUNT) collect(true);
+
+        Slot &slot = slots[head];
+        slot.width = width;
+        slot.height = height;
+        slot.name = name;
+        slot.tag = tag;
+        slot.hasGuide = guideFBO != 0;
+
+        GLsizeiptr colourSize = (GLsizeiptr)width * height * (format == GL_RED ? 1 : 3);
+        GLsizeiptr size = colourSize + (slot.hasGuide ? (GLsizeiptr)width * height * sizeof(glm::vec4) : 0);
+        slot.colourSize = colourSize;
+
+        // Reallocating also orphans the old storage
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[head]);
+        if (size != slot.size)
+        {
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+            slot.size = size;
+        }
+
+        // The reads are only queued, they land in the buffer when the GPU gets to them
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, format, GL_UNSIGNED_BYTE, (void*)0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        if (slot.hasGuide)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, guideFBO);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_FLOAT, (void*)colourSize);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        head = (head + 1) % BUFFER_COUNT;
+        pending++;
+    }
+
+    // Hand every read the GPU has finished to the callback, never blocks
+    void poll()
+    {
+        collect(false);
+    }
+
+    // Wait for every read in flight
+    void flush()
+    {
+        while (pending > 0) collect(true);
+    }
+
+    int getPending() const
+    {
+        return pending;
+    }
+
+private:
+
+    struct Slot
+    {
+        GLsync fence = 0;
+        GLsizeiptr size = 0;
+        GLsizeiptr colourSize = 0;
+        int width = 0, height = 0;
+        int tag = 0;
+        bool hasGuide = false;
+        std::string name;
+    };
+
+    GLuint buffers[BUFFER_COUNT];
+    Slot slots[BUFFER_COUNT];
+    std::function<void(const Frame &)> callback;
+    int head = 0;
+    int pending = 0;
+
+    // Process finished reads in order, waiting for the oldest one first if `wait`
+    void collect(bool wait)
+    {
+        while (pending > 0)
+        {
+            int tail = (head - pending + BUFFER_COUNT) % BUFFER_COUNT;
+            Slot &slot = slots[tail];
+
+            // Only the oldest read is ever waited for, in steps of a second
+            GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000000 : 0);
+            while (wait && status == GL_TIMEOUT_EXPIRED)
+                status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            if (status == GL_TIMEOUT_EXPIRED) return;
+            wait = false;
+
+            glDeleteSync(slot.fence);
+            slot.fence = 0;
+
+            // The buffer may not hold the pixels yet, so the read is dropped rather than mapped
+            if (status == GL_WAIT_FAILED)
+            {
+                std::cerr << "Could not wait for the pixel buffer of " << slot.name << ", the read is dropped" << std::endl;
+                pending--;
+                continue;
+            }
+
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[tail]);
+            const unsigned char *data = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.size, GL_MAP_READ_BIT);
+            if (data)
+            {
+                Frame frame = { slot.width, slot.height, slot.name, slot.tag, data, slot.hasGuide ? (const glm::vec4*)(data + slot.colourSize) : nullptr };
+                callback(frame);
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            else
+            {
+                std::cerr << "Could not map pixel buffer for " << slot.name << std::endl;
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            pending--;
+        }
+    }
+
+};
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef POSTER_RENDER_H
+#define POSTER_RENDER_H
+
+#include <GL/glew.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string>
+#include <chrono>
+#include <iostream>
+#include <glm/glm.hpp>
+#include "imgui/imgui.h"
+#include "renderer.h"
+#include "fullQuad.h"
+#include "pixelReadback.h"
+
+// Renders stills far larger than the window one tile at a time, writing each finished tile straight into its place
+// in a P6 file so memory never holds more than the tiles in flight
+class PosterRender
+{
+public:
+
+    int width = 8192, height = 8192;
+    int tileSize = 512;
+    int passesPerTile = 16;
+
+    PosterRender() {}
+
+    ~PosterRender()
+    {
+        cancel();
+    }
+
+    void init()
+    {
+        glGenFramebuffers(2, FBOs);
+        glGenTextures(2, textures);
+        readback.init([this](const PixelReadback::Frame &frame) { writeTile(frame); });
+    }
+
+    // Start rendering the scene as it is now into `path`.ppm
+    bool begin(const Renderer &renderer, const std::string &path)
+    {
+        cancel();
+
+        std::string filename = path + ".ppm";
+        fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            std::cerr << "Could not open " << filename << std::endl;
+            return false;
+        }
+
+        // The whole file is sized up front and tiles fill it in, a sparse file costs nothing until then
+        char header[64];
+        headerSize = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+        if (pwrite(fd, header, headerSize, 0) != headerSize || ftruncate(fd, headerSize + (off_t)width * height * 3) != 0)
+        {
+            std::cerr << "Could not allocate " << filename << std::endl;
+            cancel();
+            return false;
+        }
+
+        // Editing the scene meanwhile shouldn't show up halfway down the print
+        scene = renderer;
+        posterSize = glm::ivec2(width, height);
+        tileCount = glm::ivec2((width + tileSize - 1) / tileSize, (height + tileSize - 1) / tileSize);
+        posterTileSize = tileSize;
+        nextTile = 0;
+        resize();
+        return true;
+    }
+
+    // Render whole tiles for about `maxMs`, but always at least one
+    void update(FullQuad &quad, float maxMs)
+    {
+        auto start = std::chrono::steady_clock::now();
+        while (isActive() && nextTile < tileCount.x * tileCount.y)
+        {
+            glm::ivec4 tile = getTile(nextTile);
+            bool pingpong = false;
+            for (int pass = 0; pass < passesPerTile; pass++)
+            {
+                if (!scene.drawPosterTile(quad, FBOs[pingpong], textures[!pingpong], posterSize, glm::ivec2(tile.x, tile.y), glm::ivec2(tile.z, tile.w), pass))
+                {
+                    std::cerr << "Poster cancelled, the scene shader doesn't build" << std::endl;
+                    cancel();
+                    return;
+                }
+                pingpong = !pingpong;
+            }
+
+            // Only waits for the GPU once every read in the ring is still in flight
+            readback.request(FBOs[!pingpong], 0, tile.z, tile.w, "", nextTile);
+            readback.poll();
+            nextTile++;
+
+            if (std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() > maxMs) break;
+        }
+
+        if (isActive() && nextTile == tileCount.x * tileCount.y)
+        {
+            readback.flush();
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    void cancel()
+    {
+        if (fd < 0) return;
+
+        readback.flush();
+        ::close(fd);
+        fd = -1;
+    }
+
+    bool isActive() const
+    {
+        return fd >= 0;
+    }
+
+    float getProgress() const
+    {
+        return nextTile / (float)glm::max(tileCount.x * tileCount.y, 1);
+    }
+
+    void menu()
+    {
+        ImGui::DragInt("Poster width", &width, 64, 256, 65536);
+        ImGui::DragInt("Poster height", &height, 64, 256, 65536);
+        ImGui::SliderInt("Poster tile size", &tileSize, 64, 2048);
+        ImGui::SliderInt("Passes per tile", &passesPerTile, 1, 256);
+        ImGui::Text("%.1f GB file", (double)width * height * 3 / (1 << 30));
+    }
+
+private:
+
+    Renderer scene;
+    GLuint FBOs[2], textures[2];
+    PixelReadback readback;  // The tag of every read is its tile
+    int fd = -1;
+    int headerSize = 0;
+    glm::ivec2 posterSize = glm::ivec2(0, 0);
+    glm::ivec2 tileCount = glm::ivec2(0, 0);
+    int posterTileSize = 0;
+    int nextTile = 0;
+    int allocatedTileSize = 0;
+
+    // Tiles go from the top row down so the file fills front to back, as (x, y, width, height) with y up
+    glm::ivec4 getTile(int index) const
+    {
+        int x = (index % tileCount.x) * posterTileSize;
+        int top = (index / tileCount.x) * posterTileSize;
+        int tileHeight = glm::min(posterTileSize, posterSize.y - top);
+        return glm::ivec4(x, posterSize.y - top - tileHeight, glm::min(posterTileSize, posterSize.x - x), tileHeight);
+    }
+
+    void writeTile(const PixelReadback::Frame &frame)
+    {
+        glm::ivec4 tile = getTile(frame.tag);
+        size_t rowSize = (size_t)tile.z * 3;
+
+        // The read is bottom row first and the file top row first
+        for (int row = 0; row < tile.w; row++)
+        {
+            int fileRow = posterSize.y - 1 - (tile.y + row);
+            off_t offset = headerSize + ((off_t)fileRow * posterSize.x + tile.x) * 3;
+            if (pwrite(fd, frame.pixels + rowSize * row, rowSize, offset) != (ssize_t)rowSize)
+            {
+                std::cerr << "Could not write poster tile " << frame.tag << std::endl;
+                return;
+            }
+        }
+    }
+
+    // Half floats so the passes of a tile accumulate without banding
+    void resize()
+    {
+        if (posterTileSize == allocatedTileSize) return;
+        allocatedTileSize = posterTileSize;
+
+        for (int i = 0; i < 2; i++)
+        {
+            glBindTexture(GL_TEXTURE_2D, textures[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, allocatedTileSize, allocatedTileSize, 0, GL_RGBA, GL_FLOAT, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, FBOs[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[i], 0);
+
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cerr << "Poster frame buffer not complete" << std::endl;
+        }
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+};
+
+#endif
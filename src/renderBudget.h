@@ -0,0 +1,126 @@
+#ifndef RENDER_BUDGET_H
+#define RENDER_BUDGET_H
+
+#include <queue>
+#include <glm/glm.hpp>
+#include "imgui/imgui.h"
+#include "gpuTimer.h"
+
+// Decides how much work (full passes or tiles) the viewport renders each frame
+class RenderBudget
+{
+public:
+
+    enum Mode { SINGLE_PASS = 0, MULTIPLE_PASSES = 1, TILED = 2 };
+
+    int mode = SINGLE_PASS;
+    bool adaptive = true;
+    int fixedPasses = 4;
+    int maxPasses = 64;
+    float budgetMs = 12.0f;
+
+    RenderBudget() {}
+
+    void init()
+    {
+        timer.init();
+    }
+
+    // Decide how many work units to render this frame, at most `maxUnits`, and start timing them
+    int beginFrame(int maxUnits)
+    {
+        collectTimings();
+
+        units = 1;
+        if (mode == MULTIPLE_PASSES && !adaptive)
+            units = fixedPasses;
+        else if (mode != SINGLE_PASS && msPerUnit > 0.0f)
+            units = (int)(budgetMs / msPerUnit);
+        units = glm::clamp(units, 1, glm::max(maxUnits, 1));
+
+        timing = timer.begin();
+        return units;
+    }
+
+    void endFrame()
+    {
+        if (!timing) return;
+
+        timer.end();
+        timedUnits.push(units);
+    }
+
+    bool isTiled() const
+    {
+        return mode == TILED;
+    }
+
+    // Throw away the cost estimate when the meaning or cost of a unit changes
+    void resetEstimate()
+    {
+        msPerUnit = 0.0f;
+        discardedTimings = timedUnits.size();
+    }
+
+    bool menu()
+    {
+        bool updated = false;
+
+        ImGui::Text("GPU: %.3f ms/%s, %d %s/frame", msPerUnit, isTiled() ? "tile" : "pass", units, isTiled() ? "tiles" : "passes");
+        updated |= ImGui::RadioButton("Single pass", &mode, SINGLE_PASS); ImGui::SameLine();
+        updated |= ImGui::RadioButton("Multiple passes", &mode, MULTIPLE_PASSES); ImGui::SameLine();
+        updated |= ImGui::RadioButton("Tiled", &mode, TILED);
+
+        if (mode == MULTIPLE_PASSES)
+        {
+            ImGui::Checkbox("Adaptive", &adaptive);
+            if (!adaptive)
+                ImGui::SliderInt("Passes per frame", &fixedPasses, 1, 64);
+        }
+
+        if (mode == TILED || (mode == MULTIPLE_PASSES && adaptive))
+        {
+            ImGui::DragFloat("Frame budget (ms)", &budgetMs, 0.1f, 1.0f, 100.0f, "%.1f");
+            ImGui::SliderInt("Max passes", &maxPasses, 1, 256);
+        }
+
+        if (updated) resetEstimate();
+        return updated;
+    }
+
+    float getMsPerUnit() const
+    {
+        return msPerUnit;
+    }
+
+private:
+
+    GpuTimer timer;
+    std::queue<int> timedUnits;  // Unit count of every frame whose timer query is still in flight
+    int discardedTimings = 0;
+    bool timing = false;
+    int units = 1;
+    float msPerUnit = 0.0f;
+
+    void collectTimings()
+    {
+        float ms;
+        while (timer.poll(&ms))
+        {
+            float sample = ms / timedUnits.front();
+            timedUnits.pop();
+
+            if (discardedTimings > 0)
+            {
+                discardedTimings--;
+                continue;
+            }
+
+            // Smooth out the estimate so the unit count doesn't oscillate
+            msPerUnit = msPerUnit > 0.0f ? glm::mix(msPerUnit, sample, 0.2f) : sample;
+        }
+    }
+
+};
+
+#endif
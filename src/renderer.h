@@ -11,33 +11,52 @@
 #include "imgui/imgui.h"
 #include "utils.h"
 #include "shader.h"
+#include "uniformBlock.h"
 #include "camera.h"
 #include "material.h"
 #include "light.h"
 #include "frameInterpolator.h"
+#include "window.h"
+#include "fullQuad.h"
 
 class Renderer
 {
 public:
 
+    static constexpr int MAX_LAYER_PASSES = 256;  // The layers of a TAA image converged further average this many
+
     Renderer () {}
 
     Renderer(glm::ivec2 windowDimensions)
     {
-        shader = Shader("./src/shaders/quad.vert", "./src/shaders/main.frag");
+        shader = Shader("quad.vert", "main.frag", SCENE_FEATURES);
+        checkerboardShader = Shader("quad.vert", "checkerboard.frag");
+        upsampleShader = Shader("quad.vert", "upsample.frag");
+        edgeShader = Shader("quad.vert", "edges.frag");
+        canCompute = GLEW_VERSION_4_3;
+        initBlocks();
         camera = Camera(windowDimensions, 5.4, 1.3, 18.0, 3.0);
         mat = Material(0.5, 0.0, glm::vec3(0.4, 0.2, 0.0));
         light = Light(glm::vec3(1.0), glm::vec3(1.0), 5.0);
         setResolution(windowDimensions);
+
+        // The first pass waits for its variant, the only one built here, the variants of later settings are built in
+        // the background
+        passFeatures = getFeatures(doPixelSampling, doTAA);
+        useSceneShader(passFeatures);
+        lastPassCamera = camera;
+        lastPassResolution = resolution;
     }
 
     void onUpdate()
     {
         renderedFrameCount = 0;
         skipAA = 2;  // Skip anti aliasing for the next 2 frames
+        sceneVersion++;
     }
     
-    void renderScene(int prevTextureUnit)
+    // Set up the shader for one accumulation pass, which may be drawn in several pieces
+    void beginPass(int prevTextureUnit)
     {
         static float currFrameTime = 0.0f, lastFrameTime = std::chrono::duration<float>(std::chrono::steady_clock::now().time_since_epoch()).count();
 
@@ -46,84 +65,689 @@ public:
         u_time += currFrameTime - lastFrameTime;
         lastFrameTime = currFrameTime;
 
-        // Set uniforms
+        // Alternate which half of the pixels get marched
+        checkerboardParity = !checkerboardParity;
+
+        // The variant of the scene shader for this pass's settings, uniforms are set on the bound program. Until
+        // a new variant is built the passes keep drawing with the last one, so changing settings never stalls
+        doTemporalAntiAliasing = skipAA ? --skipAA > 1 : doTAA;
+        unsigned features = getFeatures(doPixelSampling, doTemporalAntiAliasing);
+        if (shader.findVariant(features))
+        {
+            // The passes drawn with the last one don't match the settings, so they're left out of the average
+            if (features != passFeatures && drawingStaleVariant)
+            {
+                renderedFrameCount = 0;
+                sceneVersion++;
+            }
+            passFeatures = features;
+            drawingStaleVariant = false;
+        }
+        else
+        {
+            drawingStaleVariant = true;
+        }
+        useSceneShader(passFeatures);
+
+        // Sub-pixel offset of the low resolution samples, restarting the sequence whenever accumulation does
+        upsamplingJitter = glm::vec2(halton(renderedFrameCount + 1, 2), halton(renderedFrameCount + 1, 3)) - 0.5f;
+
+        // Set uniforms, the scene blocks are only sent when they've changed
         setRenderingUniforms(prevTextureUnit);
-        setFractalUniforms();
-        setWorldUniforms();
-        setCameraUniforms();
-        setMaterialUniforms();
-        setLightUniforms();
+        uploadBlocks();
+
+        if (doCheckerboard)
+        {
+            checkerboardShader.use();
+            setCheckerboardUniforms(prevTextureUnit);
+        }
+
+        if (doUpsampling)
+        {
+            upsampleShader.use();
+            setUpsamplingUniforms(prevTextureUnit);
+        }
+
+        if (isEdgeSampling())
+        {
+            edgeShader.use();
+            setEdgeUniforms();
+        }
+
+        lastPassCamera = camera;
+        lastPassResolution = resolution;
+        lastPassFrameCount = renderedFrameCount;
+    }
+
+    // Draw `region` of the current pass into ping-pong FBO `pingpong`, reading the other texture as the previous frame
+    void draw(FullQuad &quad, const Window &window, bool pingpong, glm::ivec4 region)
+    {
+        // Full passes go to the compute backend once its variant for them is built
+        Shader *computeVariant = isComputePass() ? computeShader.findVariant(passFeatures) : nullptr;
+        if (computeVariant)
+        {
+            dispatch(*computeVariant, window, pingpong, region);
+            return;
+        }
+
+        // The shaders write every channel themselves, depth included
+        glDisable(GL_BLEND);
+        glEnable(GL_SCISSOR_TEST);
+
+        // Get previous frame texture unit and bind it (this way we can use it in the scene shader as a uniform)
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, window.textures[!pingpong]);
 
-        // Render scene
-        shader.use();
+        Shader *resolveShader = nullptr;
+        if (doUpsampling)
+        {
+            // March the jittered low resolution samples covering the region, plus an apron for the reconstruction filter
+            glm::ivec2 sampleRes = sampleResolution();
+            glm::ivec2 from = glm::ivec2(glm::floor(glm::vec2(region.x, region.y) * upsamplingScale)) - 2;
+            glm::ivec2 to = glm::ivec2(glm::ceil(glm::vec2(region.x + region.z, region.y + region.w) * upsamplingScale)) + 2;
+            drawSamples(quad, window, sampleRes, from, to);
+            resolveShader = &upsampleShader;
+        }
+        else if (doCheckerboard)
+        {
+            // March this frame's half of the pixels into the half-width sample texture, plus an apron the resolve reads
+            glm::ivec2 from = glm::ivec2(region.x / 2, region.y) - 1;
+            glm::ivec2 to = glm::ivec2((region.x + region.z + 1) / 2, region.y + region.w) + 1;
+            drawSamples(quad, window, glm::ivec2((resolution.x + 1) / 2, resolution.y), from, to);
+            resolveShader = &checkerboardShader;
+        }
+        else if (isEdgeSampling())
+        {
+            // Single sample per pixel with its G-buffer, plus the neighbours the edge detection reads
+            glm::ivec2 from = glm::ivec2(region.x, region.y) - 1;
+            glm::ivec2 to = glm::ivec2(region.x + region.z, region.y + region.w) + 1;
+            sceneShader->use();
+            uniforms.doSingleSample.set(true);
+            drawSamples(quad, window, resolution, from, to);
+
+            // Copy the single sample of smooth pixels and mark them in the stencil buffer, edges are discarded
+            glBindFramebuffer(GL_FRAMEBUFFER, window.FBOs[pingpong]);
+            glViewport(0, 0, resolution.x, resolution.y);
+            glScissor(region.x, region.y, region.z, region.w);
+            glEnable(GL_STENCIL_TEST);
+            glClear(GL_STENCIL_BUFFER_BIT);
+            glStencilFunc(GL_ALWAYS, 1, 0xFF);
+            glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+            edgeShader.use();
+            quad.render();
+
+            // Supersample only the unmarked pixels, so the work is packed onto the edges
+            sceneShader->use();
+            uniforms.doSingleSample.set(false);
+            glStencilFunc(GL_EQUAL, 0, 0xFF);
+            glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+        }
+
+        // Render the scene, or reconstruct it from the samples
+        glBindFramebuffer(GL_FRAMEBUFFER, window.FBOs[pingpong]);
+        glViewport(0, 0, resolution.x, resolution.y);
+        glScissor(region.x, region.y, region.z, region.w);
+        if (resolveShader) resolveShader->use();
+        else sceneShader->use();
+        quad.render();
+
+        // Unbind textures and FBO
+        for (int unit = 2; unit >= 0; unit--)
+        {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glDisable(GL_STENCIL_TEST);
+        glDisable(GL_SCISSOR_TEST);
+        glEnable(GL_BLEND);
+    }
+
+    // March `region` of the current pass with the compute backend, straight into ping-pong texture `pingpong`. The
+    // classify stage fills in the pixels that miss the bounding sphere and queues the rest, one dispatch of 8x8 tiles,
+    // then persistent groups shade the queue, as few as can drain it if the whole region was queued
+    void dispatch(Shader &variant, const Window &window, bool pingpong, glm::ivec4 region)
+    {
+        // Everything else the scene reads is in the blocks beginPass sent
+        if (&variant != computeVariant || variant.getVersion() != computeVariantVersion)
+        {
+            computeVariant = &variant;
+            computeVariantVersion = variant.getVersion();
+            loadComputeUniforms();
+        }
+        variant.use();
+        computeUniforms.renderedFrameCount.set(renderedFrameCount);
+        computeUniforms.prevFrameTexture.set(0);
+        computeUniforms.u_time.set(u_time);
+        computeUniforms.region.set(region);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, window.textures[!pingpong]);
+        glBindImageTexture(0, window.textures[pingpong], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+        // The queue starts empty, with room for every pixel of the region after its two counters
+        GLsizeiptr queueSize = (2 + (GLsizeiptr)region.z*region.w) * sizeof(GLuint);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, rayQueue);
+        if (queueSize > rayQueueSize)
+        {
+            glBufferData(GL_SHADER_STORAGE_BUFFER, queueSize, NULL, GL_DYNAMIC_COPY);
+            rayQueueSize = queueSize;
+        }
+        GLuint counters[2] = { 0, 0 };
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counters), counters);
+
+        computeUniforms.stage.set(0);
+        glDispatchCompute((region.z + 7) / 8, (region.w + 7) / 8, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        computeUniforms.stage.set(1);
+        computeUniforms.raysPerInvocation.set(raysPerInvocation);
 
+        // Split into as many dispatches as the limit on groups takes, they all take pixels from the same queue
+        GLuint64 groups = ((GLuint64)region.z*region.w + 64*raysPerInvocation - 1) / (64*raysPerInvocation);
+        while (groups > 0)
+        {
+            GLuint dispatched = (GLuint)std::min(groups, (GLuint64)maxComputeGroups);
+            glDispatchCompute(dispatched, 1, 1);
+            groups -= dispatched;
+            if (groups > 0) glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+
+        // The next pass samples the texture, and it's drawn, blitted and read back like any other
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+
+        // Unbind texture, image and buffer
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    }
+
+    // March the sample pass into the sample texture, within the rectangle [from, to) of a `viewportSize` viewport
+    void drawSamples(FullQuad &quad, const Window &window, glm::ivec2 viewportSize, glm::ivec2 from, glm::ivec2 to)
+    {
+        from = glm::max(from, glm::ivec2(0, 0));
+        to = glm::min(to, viewportSize);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, window.sampleFBO);
+        glViewport(0, 0, viewportSize.x, viewportSize.y);
+        glScissor(from.x, from.y, to.x - from.x, to.y - from.y);
+        sceneShader->use();
+        quad.render();
+
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, window.gBufferTexture);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, window.sampleTexture);
+    }
+
+    // Render the normal and depth at the centre of every pixel, once per version of the scene
+    void updateGuide(FullQuad &quad, const Window &window)
+    {
+        if (guideSceneVersion == sceneVersion) return;
+        guideSceneVersion = sceneVersion;
+
+        // Everything else is still set from the latest pass of this scene version
+        sceneShader->use();
+        uploadBlocks();
+        uniforms.doSingleSample.set(true);
+
+        glDisable(GL_BLEND);
+        glBindFramebuffer(GL_FRAMEBUFFER, window.guideFBO);
+        glViewport(0, 0, resolution.x, resolution.y);
+        quad.render();
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glEnable(GL_BLEND);
+
+        uniforms.doSingleSample.set(false);
+    }
+
+    // Render the image of the last pass again as linear colour premultiplied by coverage, the G-buffer and escape
+    // iterations into the three attachments of `fbo`. The scene blocks are left as that pass sent them, so the
+    // layers match the image even if the scene has changed since. With TAA the image averages every pass since the
+    // scene changed, so the colour and coverage average as many passes, up to MAX_LAYER_PASSES. False if the variant
+    // for the layers doesn't build, nothing is drawn then
+    bool drawLayers(FullQuad &quad, GLuint fbo)
+    {
+        if (!useSceneShader(getFeatures(true, false))) return false;
+        setRenderingUniforms(0);
+        uniforms.doLayers.set(true);
+
+        RenderingBlock passRendering = renderingBlock.data;
+        renderingBlock.data.doCheckerboard = false;
+        renderingBlock.data.doUpsampling = false;
+        renderingBlock.data.resolution = lastPassResolution;
+        renderingBlock.dirty = true;
+        renderingBlock.upload();
+
+        bool accumulated = passFeatures & FEATURE_TEMPORAL_ANTI_ALIASING;
+        int passes = accumulated ? std::min(lastPassFrameCount + 1, MAX_LAYER_PASSES) : 1;
+
+        // Only the colour and coverage are blended, each pass adds its share of the average. The G-buffer and
+        // iterations are the last pass's
+        const GLfloat zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, lastPassResolution.x, lastPassResolution.y);
+        glClearBufferfv(GL_COLOR, 0, zero);
+        glDisable(GL_BLEND);
+        glEnablei(GL_BLEND, 0);
+        glBlendColor(0.0f, 0.0f, 0.0f, 1.0f / passes);
+        glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE);
+        for (int pass = 0; pass < passes; pass++)
+        {
+            uniforms.renderedFrameCount.set(accumulated ? lastPassFrameCount + 1 - passes + pass : lastPassFrameCount);
+            quad.render();
+        }
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glEnable(GL_BLEND);
+
+        // Back to the settings of the pass
+        uniforms.doLayers.set(false);
+        renderingBlock.data = passRendering;
+        renderingBlock.dirty = true;
+        renderingBlock.upload();
+        useSceneShader(passFeatures);
+        return true;
+    }
+
+    // Draw pass `pass` of the `size` tile at `offset` of a `posterSize` image into `fbo`, blending it with the passes
+    // already in `prevTexture`. The poster is framed like the window, with its own aspect ratio and pixel count.
+    // With a `downsampling` over 1 the tile is of a level where every pixel covers that many pixels of the poster
+    // each way, counted from its top left, so a partial last row and column reach past the poster's edges. False if
+    // the variant for the pass doesn't build, nothing is drawn then
+    bool drawPosterTile(FullQuad &quad, GLuint fbo, GLuint prevTexture, glm::ivec2 posterSize, glm::ivec2 offset, glm::ivec2 size, int pass, int downsampling = 1)
+    {
+        Camera posterCamera = camera;
+        posterCamera.updateDimensions(posterSize);
+        Camera::Viewport &viewport = posterCamera.viewport;
+        if (downsampling > 1)
+        {
+            // The level's rows count from the bottom like the poster's, but start below it by its partial last row
+            glm::ivec2 levelSize = (posterSize + downsampling - 1) / downsampling;
+            float below = (float)(levelSize.y*downsampling - posterSize.y);
+            viewport.origin += 0.5f*(1 - downsampling)*(viewport.pixelDW + viewport.pixelDH) - below*viewport.pixelDH;
+            viewport.pixelDW *= (float)downsampling;
+            viewport.pixelDH *= (float)downsampling;
+        }
+
+        if (!useSceneShader(getFeatures(true, pass > 0))) return false;
+        uniforms.doSingleSample.set(false);
+        uniforms.doLayers.set(false);
+        uniforms.renderedFrameCount.set(pass);
+        uniforms.prevFrameTexture.set(0);
+        uniforms.u_time.set(u_time);
+
+        // The rendering and camera blocks are the tile's own, and filled again for the next pass of the window
+        uploadBlocks();
+        fillRenderingBlock();
+        renderingBlock.data.doCheckerboard = false;
+        renderingBlock.data.doUpsampling = false;
+        renderingBlock.data.resolution = size;
+        renderingBlock.dirty = true;
+        renderingBlock.upload();
+
+        // The tile's pixel (0, 0) is the poster's pixel `offset`
+        fillCameraBlock(posterCamera);
+        cameraBlock.data.viewportOrigin = viewport.origin + (float)offset.x*viewport.pixelDW + (float)offset.y*viewport.pixelDH;
+        cameraBlock.dirty = true;
+        cameraBlock.upload();
+        renderingBlock.dirty = cameraBlock.dirty = true;
+
+        glDisable(GL_BLEND);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, prevTexture);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, size.x, size.y);
+        quad.render();
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glEnable(GL_BLEND);
+        return true;
+    }
+
+    void endPass()
+    {
         renderedFrameCount++;
     }
 
+    // Hash of every setting that changes the image, two renders with the same hash are the same
+    uint64_t hashScene() const
+    {
+        uint64_t hash = hashBytes(&camera.lookfrom, sizeof(camera.lookfrom));
+        hash = hashBytes(&camera.lookat, sizeof(camera.lookat), hash);
+        hash = hashBytes(&camera.focalLength, sizeof(camera.focalLength), hash);
+        hash = hashBytes(&camera.viewport.height, sizeof(camera.viewport.height), hash);
+        hash = hashBytes(&maxIterations, sizeof(maxIterations), hash);
+        hash = hashBytes(&c, sizeof(c), hash);
+        hash = hashBytes(&w, sizeof(w), hash);
+        hash = hashBytes(&boundingRadius, sizeof(boundingRadius), hash);
+        hash = hashBytes(&escapeThreshold, sizeof(escapeThreshold), hash);
+        hash = hashBytes(&epsilon, sizeof(epsilon), hash);
+        hash = hashBytes(&mat.roughness, sizeof(mat.roughness), hash);
+        hash = hashBytes(&mat.metallic, sizeof(mat.metallic), hash);
+        hash = hashBytes(&mat.albedo, sizeof(mat.albedo), hash);
+        hash = hashBytes(&light.position, sizeof(light.position), hash);
+        hash = hashBytes(&light.colour, sizeof(light.colour), hash);
+        hash = hashBytes(&light.intensity, sizeof(light.intensity), hash);
+        hash = hashBytes(&backgroundColour, sizeof(backgroundColour), hash);
+        hash = hashBytes(&samplingMethod, sizeof(samplingMethod), hash);
+        hash = hashBytes(&samplesPerPixel, sizeof(samplesPerPixel), hash);
+        hash = hashBytes(&doGammaCorrection, sizeof(doGammaCorrection), hash);
+        hash = hashBytes(&doPacketMarching, sizeof(doPacketMarching), hash);
+        hash = hashBytes(&test, sizeof(test), hash);
+
+        // The same settings look different once the scene shader or any file it includes is edited
+        uint64_t sourceHash = sceneShader->getSourceHash();
+        return hashBytes(&sourceHash, sizeof(sourceHash), hash);
+    }
+
+    glm::ivec2 getLastPassResolution() const
+    {
+        return lastPassResolution;
+    }
+
+    int getSceneVersion() const
+    {
+        return sceneVersion;
+    }
+
+    // Resolution the samples are marched at when upsampling
+    glm::ivec2 sampleResolution() const
+    {
+        return glm::max(glm::ivec2(glm::ceil(glm::vec2(resolution) * upsamplingScale)), glm::ivec2(1, 1));
+    }
+
+    bool isAccumulating() const
+    {
+        return doTAA;
+    }
+
+    // Passes finished since the scene last changed, the last of them is the one displayed
+    int getCompletedPasses() const
+    {
+        return renderedFrameCount;
+    }
+
+    // Number of passes averaged into the current image
+    int getAccumulatedPasses() const
+    {
+        return doTAA ? glm::max(renderedFrameCount, 1) : 1;
+    }
+
+    // Sample every pixel on an even `samples`*`samples` grid without gamma correction, so renders of the same view at
+    // different scales can be compared by averaging
+    void setGridSampling(int samples)
+    {
+        samplingMethod = 2;
+        samplesPerPixel = samples;
+        doGammaCorrection = false;
+        doPacketMarching = false;
+        renderingBlock.dirty = true;
+    }
+
+    // Edge-aware sampling replaces uniform supersampling of still frames, the other modes bring their own samples
+    bool isEdgeSampling() const
+    {
+        return doEdgeSampling && doPixelSampling && !doTAA && !doCheckerboard && !doUpsampling;
+    }
+
+    // The compute backend only draws full passes, checkerboard, upsampled and edge-sampled ones reconstruct theirs
+    bool isComputePass() const
+    {
+        return doCompute && !doCheckerboard && !doUpsampling && !isEdgeSampling();
+    }
+
     void setResolution(glm::ivec2 newResolution)
     {
         resolution = newResolution;
         camera.updateDimensions(newResolution);
+        renderingBlock.dirty = cameraBlock.dirty = true;
         onUpdate();
     }
 
 
     // * Uniform Setters
 
+    // Flags of the scene shader variant for the current settings, sampling and accumulation are given per draw
+    unsigned getFeatures(bool pixelSampling, bool temporalAntiAliasing) const
+    {
+        unsigned features = 0;
+        if (test) features |= FEATURE_TEST;
+        if (pixelSampling) features |= FEATURE_PIXEL_SAMPLING;
+        if (doGammaCorrection) features |= FEATURE_GAMMA_CORRECTION;
+        if (temporalAntiAliasing) features |= FEATURE_TEMPORAL_ANTI_ALIASING;
+
+        // The sampling method only matters when pixels are sampled
+        if (pixelSampling || temporalAntiAliasing)
+        {
+            if (samplingMethod == 1) features |= FEATURE_JITTERED_GRID_SAMPLING;
+            else if (samplingMethod == 2) features |= FEATURE_GRID_SAMPLING;
+        }
+
+        return features;
+    }
+
+    // Bind the scene shader variant for `features`, waiting for it if it isn't built yet. If it doesn't build, false,
+    // and the last variant stays bound so the window keeps drawing while a shader is being edited
+    bool useSceneShader(unsigned features)
+    {
+        Shader *variant = shader.getVariant(features);
+        if (!variant)
+        {
+            // There's nothing to fall back to at startup
+            if (!sceneShader) exit(1);
+            sceneShader->use();
+            return false;
+        }
+
+        if (variant != sceneShader || variant->getVersion() != sceneShaderVersion)
+        {
+            sceneShader = variant;
+            sceneShaderVersion = variant->getVersion();
+            loadUniforms();
+        }
+        sceneShader->use();
+        return true;
+    }
+
+    // Resolve the current variant's uniforms once, rather than by name on every set
+    void loadUniforms()
+    {
+        sceneShader->getUniform("doSingleSample", uniforms.doSingleSample);
+        sceneShader->getUniform("doLayers", uniforms.doLayers);
+        sceneShader->getUniform("checkerboardParity", uniforms.checkerboardParity);
+        sceneShader->getUniform("renderedFrameCount", uniforms.renderedFrameCount);
+        sceneShader->getUniform("prevFrameTexture", uniforms.prevFrameTexture);
+        sceneShader->getUniform("upsamplingJitter", uniforms.upsamplingJitter);
+        sceneShader->getUniform("u_time", uniforms.u_time);
+    }
+
+    // The same for the compute variant dispatched last
+    void loadComputeUniforms()
+    {
+        computeVariant->getUniform("renderedFrameCount", computeUniforms.renderedFrameCount);
+        computeVariant->getUniform("prevFrameTexture", computeUniforms.prevFrameTexture);
+        computeVariant->getUniform("u_time", computeUniforms.u_time);
+        computeVariant->getUniform("region", computeUniforms.region);
+        computeVariant->getUniform("stage", computeUniforms.stage);
+        computeVariant->getUniform("raysPerInvocation", computeUniforms.raysPerInvocation);
+    }
+
+    // Everything that changes from one pass or draw to the next, the rest is in the blocks
     void setRenderingUniforms(GLint prevTextureUnit)
     {
-        doTemporalAntiAliasing = skipAA ? --skipAA > 1 : doTAA;
-        shader.setBool("test", test);
-        shader.setBool("doPixelSampling", doPixelSampling);
-        shader.setBool("doGammaCorrection", doGammaCorrection);
-        shader.setBool("doTemporalAntiAliasing", doTemporalAntiAliasing);
+        uniforms.checkerboardParity.set(checkerboardParity);
+        uniforms.upsamplingJitter.set(upsamplingJitter);
+        uniforms.doSingleSample.set(false);
+        uniforms.doLayers.set(false);
 
-        shader.setInt("renderedFrameCount", renderedFrameCount);
-        shader.setInt("samplingMethod", samplingMethod);
-        shader.setInt("samplesPerPixel", samplesPerPixel);
-        shader.setInt("prevFrameTexture", prevTextureUnit);
+        uniforms.renderedFrameCount.set(renderedFrameCount);
+        uniforms.prevFrameTexture.set(prevTextureUnit);
+        uniforms.u_time.set(u_time);
+    }
 
-        shader.setVec2i("resolution", resolution);
+    void setUpsamplingUniforms(GLint prevTextureUnit)
+    {
+        upsampleShader.setBool("doTemporalAntiAliasing", doTemporalAntiAliasing);
+        upsampleShader.setInt("renderedFrameCount", renderedFrameCount);
+        upsampleShader.setFloat("upsamplingScale", upsamplingScale);
+        upsampleShader.setVec2f("upsamplingJitter", upsamplingJitter);
+        upsampleShader.setVec2i("sampleResolution", sampleResolution());
+        upsampleShader.setInt("prevFrameTexture", prevTextureUnit);
+        upsampleShader.setInt("sampleTexture", 1);
     }
 
-    void setFractalUniforms()
+    void setEdgeUniforms()
     {
-        shader.setInt("maxIterations", maxIterations);
-        shader.setVec4f("c", c);
-        shader.setFloat("w", w);
-        shader.setFloat("escapeThreshold", escapeThreshold);
-        shader.setFloat("boundingRadius2", boundingRadius*boundingRadius);
-        shader.setFloat("epsilon", epsilon);
+        edgeShader.setBool("showEdges", showEdges);
+        edgeShader.setFloat("edgeDepthThreshold", edgeDepthThreshold);
+        edgeShader.setFloat("edgeNormalThreshold", edgeNormalThreshold);
+        edgeShader.setVec2i("resolution", resolution);
+        edgeShader.setInt("sampleTexture", 1);
+        edgeShader.setInt("gBufferTexture", 2);
     }
 
-    void setWorldUniforms()
+    void setCheckerboardUniforms(GLint prevTextureUnit)
     {
-        shader.setVec3f("backgroundColour", backgroundColour);
-        shader.setFloat("u_time", u_time);
+        checkerboardShader.setBool("doTemporalAntiAliasing", doTemporalAntiAliasing);
+        checkerboardShader.setInt("renderedFrameCount", renderedFrameCount);
+        checkerboardShader.setInt("checkerboardParity", checkerboardParity);
+        checkerboardShader.setVec2i("resolution", resolution);
+        checkerboardShader.setVec2i("prevResolution", lastPassResolution);
+        checkerboardShader.setInt("prevFrameTexture", prevTextureUnit);
+        checkerboardShader.setInt("checkerboardTexture", 1);
+
+        // This pass's camera is read from the camera block
+        checkerboardShader.setVec3f("prevLookfrom", lastPassCamera.lookfrom);
+        checkerboardShader.setVec3f("prevPixelDW", lastPassCamera.viewport.pixelDW);
+        checkerboardShader.setVec3f("prevPixelDH", lastPassCamera.viewport.pixelDH);
+        checkerboardShader.setVec3f("prevViewportOrigin", lastPassCamera.viewport.origin);
     }
 
-    void setCameraUniforms()
+
+
+    // * Uniform Blocks
+
+    void initBlocks()
     {
-        shader.setFloat("cameraDistance", camera.distance);
-        shader.setVec3f("lookfrom", camera.lookfrom);
-        shader.setVec3f("pixelDW", camera.viewport.pixelDW);
-        shader.setVec3f("pixelDH", camera.viewport.pixelDH);
-        shader.setVec3f("viewportOrigin", camera.viewport.origin);
+        renderingBlock.init(RENDERING_BINDING);
+        fractalBlock.init(FRACTAL_BINDING);
+        worldBlock.init(WORLD_BINDING);
+        cameraBlock.init(CAMERA_BINDING);
+        materialBlock.init(MATERIAL_BINDING);
+        lightBlock.init(LIGHT_BINDING);
+
+        shader.bindBlock("RenderingBlock", RENDERING_BINDING, sizeof(RenderingBlock));
+        shader.bindBlock("FractalBlock", FRACTAL_BINDING, sizeof(FractalBlock));
+        shader.bindBlock("WorldBlock", WORLD_BINDING, sizeof(WorldBlock));
+        shader.bindBlock("CameraBlock", CAMERA_BINDING, sizeof(CameraBlock));
+        shader.bindBlock("MaterialBlock", MATERIAL_BINDING, sizeof(MaterialBlock));
+        shader.bindBlock("LightBlock", LIGHT_BINDING, sizeof(LightBlock));
+        checkerboardShader.bindBlock("CameraBlock", CAMERA_BINDING, sizeof(CameraBlock));
+    }
+
+    // The compute backend is set up the first time it's turned on, its variants are built in the background and
+    // passes are drawn with main.frag until the one they need is ready. Its scene reads the same blocks as main.frag's
+    void initCompute()
+    {
+        computeShader = Shader("", "main.comp", SCENE_FEATURES);
+        computeShader.bindBlock("RenderingBlock", RENDERING_BINDING, sizeof(RenderingBlock));
+        computeShader.bindBlock("FractalBlock", FRACTAL_BINDING, sizeof(FractalBlock));
+        computeShader.bindBlock("WorldBlock", WORLD_BINDING, sizeof(WorldBlock));
+        computeShader.bindBlock("CameraBlock", CAMERA_BINDING, sizeof(CameraBlock));
+        computeShader.bindBlock("MaterialBlock", MATERIAL_BINDING, sizeof(MaterialBlock));
+        computeShader.bindBlock("LightBlock", LIGHT_BINDING, sizeof(LightBlock));
+        glGenBuffers(1, &rayQueue);
+
+        GLint maxGroups = 0;
+        glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &maxGroups);
+        maxComputeGroups = (GLuint)glm::max(maxGroups, 1);
+    }
+
+    // Refill the blocks the menus have changed and send them
+    void uploadBlocks()
+    {
+        if (renderingBlock.dirty) fillRenderingBlock();
+        if (fractalBlock.dirty) fillFractalBlock();
+        if (worldBlock.dirty) fillWorldBlock();
+        if (cameraBlock.dirty) fillCameraBlock(camera);
+        if (materialBlock.dirty) fillMaterialBlock();
+        if (lightBlock.dirty) fillLightBlock();
+
+        renderingBlock.upload();
+        fractalBlock.upload();
+        worldBlock.upload();
+        cameraBlock.upload();
+        materialBlock.upload();
+        lightBlock.upload();
+    }
+
+    void markBlocksDirty()
+    {
+        renderingBlock.dirty = fractalBlock.dirty = worldBlock.dirty = true;
+        cameraBlock.dirty = materialBlock.dirty = lightBlock.dirty = true;
+    }
+
+    void fillRenderingBlock()
+    {
+        RenderingBlock &block = renderingBlock.data;
+        block.resolution = resolution;
+        block.samplesPerPixel = samplesPerPixel;
+        block.doCheckerboard = doCheckerboard;
+        block.doUpsampling = doUpsampling;
+        block.doPacketMarching = doPacketMarching;
+        block.upsamplingScale = upsamplingScale;
     }
 
-    void setMaterialUniforms()
+    void fillFractalBlock()
     {
-        shader.setFloat("roughness", mat.roughness);
-        shader.setFloat("metallic", mat.metallic);
-        shader.setVec3f("albedo", mat.albedo);
-        shader.setVec3f("F0", mat.F0);
+        FractalBlock &block = fractalBlock.data;
+        block.c = c;
+        block.maxIterations = maxIterations;
+        block.w = w;
+        block.boundingRadius2 = boundingRadius*boundingRadius;
+        block.escapeThreshold = escapeThreshold;
+        block.epsilon = epsilon;
     }
 
-    void setLightUniforms()
+    void fillWorldBlock()
     {
-        shader.setVec3f("lightPos", light.position);
-        shader.setVec3f("lightColour", light.colour);
-        shader.setFloat("lightIntensity", light.intensity);
+        worldBlock.data.backgroundLinear = linearize(backgroundColour);
+    }
+
+    void fillCameraBlock(const Camera &blockCamera)
+    {
+        CameraBlock &block = cameraBlock.data;
+        block.lookfrom = blockCamera.lookfrom;
+        block.cameraDistance = blockCamera.distance;
+        block.pixelDW = blockCamera.viewport.pixelDW;
+        block.pixelDH = blockCamera.viewport.pixelDH;
+        block.viewportOrigin = blockCamera.viewport.origin;
+    }
+
+    // The BRDF terms that only depend on the material are worked out here rather than for every sample
+    void fillMaterialBlock()
+    {
+        MaterialBlock &block = materialBlock.data;
+        float alpha = mat.roughness*mat.roughness;
+        block.roughnessA2 = alpha*alpha;
+        block.roughnessK = (mat.roughness + 1.0f)*(mat.roughness + 1.0f) / 8.0f;
+        block.diffuse = linearize(mat.albedo) * (1.0f - mat.metallic) / (float)PI;
+        block.F0 = mat.F0;
+    }
+
+    void fillLightBlock()
+    {
+        LightBlock &block = lightBlock.data;
+        block.lightPos = light.position;
+        block.lightRadiance = linearize(light.colour) * light.intensity;
+    }
+
+    // Colours are picked in display space and shaded in linear space
+    glm::vec3 linearize(glm::vec3 colour) const
+    {
+        return doGammaCorrection ? glm::pow(colour, glm::vec3(2.2f)) : colour;
     }
 
     // * GUI
@@ -196,8 +820,40 @@ public:
         bool updated = false;
 
         updated |= ImGui::Checkbox("Test", (bool*)&(test));
-        updated |= ImGui::Checkbox("Gamma Correction", (bool*)&(doGammaCorrection));
+        if (ImGui::Checkbox("Gamma Correction", (bool*)&(doGammaCorrection)))
+        {
+            // Every colour in the blocks is linearized by it
+            updated = true;
+            markBlocksDirty();
+        }
         updated |= ImGui::Checkbox("Temporal Anti-Aliasing", &(doTAA));
+
+        // Checkerboard and upsampling both reconstruct the frame from the sample texture, so only one can be on
+        if (ImGui::Checkbox("Checkerboard", &(doCheckerboard)))
+        {
+            updated = true;
+            doUpsampling = false;
+        }
+        if (ImGui::Checkbox("Temporal Upsampling", &(doUpsampling)))
+        {
+            updated = true;
+            doCheckerboard = false;
+        }
+        if (doUpsampling)
+        {
+            updated |= ImGui::SliderFloat("Upsampling scale", &upsamplingScale, 0.25f, 1.0f, "%.2f");
+        }
+
+        // Needs a GL 4.3 context, and only draws full passes
+        if (canCompute && ImGui::Checkbox("Compute backend", &(doCompute)))
+        {
+            updated = true;
+            if (doCompute && !rayQueue) initCompute();
+        }
+        if (canCompute && doCompute)
+        {
+            updated |= ImGui::SliderInt("Rays per invocation", &raysPerInvocation, 1, 16);
+        }
         
         if (doTAA)
         {
@@ -231,9 +887,31 @@ public:
 
             // Set number of pixel samples
             updated |= ImGui::SliderInt("Samples per pixel", &(samplesPerPixel), 1, 20, samplingMethod == 1 ? "%d^2" : "%d");
+
+            if (samplingMethod != 0)
+            {
+                // Grids of up to 4x4 samples can be marched together
+                updated |= ImGui::Checkbox("Packet marching", &(doPacketMarching));
+            }
+
+            if (!doTAA)
+            {
+                // Only supersample the pixels on silhouettes and creases
+                updated |= ImGui::Checkbox("Edge-aware sampling", &(doEdgeSampling));
+                if (doEdgeSampling)
+                {
+                    updated |= ImGui::Checkbox("Show edges", &(showEdges));
+                    updated |= ImGui::SliderFloat("Edge depth threshold", &edgeDepthThreshold, 0.001f, 0.2f, "%.3f");
+                    updated |= ImGui::SliderFloat("Edge normal threshold", &edgeNormalThreshold, 0.0f, 1.0f, "%.3f");
+                }
+            }
         }
 
-        if (updated) onUpdate();
+        if (updated)
+        {
+            renderingBlock.dirty = true;
+            onUpdate();
+        }
     }
 
     void fractalMenu(FrameInterpolator *frameInterpolator)
@@ -255,7 +933,11 @@ public:
         DragFloatKeyframe(frameInterpolator, &update, "##c.z", &c.z, coordSpeed, -4.0f, 4.0f, coordFormat);
         DragFloatKeyframe(frameInterpolator, &update, "##c.w", &c.w, coordSpeed, -4.0f, 4.0f, coordFormat);
 
-        if (update) onUpdate();
+        if (update)
+        {
+            fractalBlock.dirty = true;
+            onUpdate();
+        }
     }
 
     void worldMenu(FrameInterpolator *frameInterpolator)
@@ -270,7 +952,11 @@ public:
 
         updated |= ImGui::ColorEdit3("Background Colour", &backgroundColour.x);
 
-        if (updated) onUpdate();
+        if (updated)
+        {
+            worldBlock.dirty = true;
+            onUpdate();
+        }
         
     }
 
@@ -285,7 +971,11 @@ public:
         
         update |= updateF0;
         if (updateF0) mat.setF0();
-        if (update) onUpdate();
+        if (update)
+        {
+            materialBlock.dirty = true;
+            onUpdate();
+        }
     }
 
     void lightMenu(FrameInterpolator *frameInterpolator)
@@ -296,7 +986,11 @@ public:
         update |= ImGui::DragFloat3("Position", &light.position.x, 0.01, -boundingRadius, boundingRadius);
         update |= ImGui::ColorEdit3("Colour", &(light.colour.x));
 
-        if (update) onUpdate();
+        if (update)
+        {
+            lightBlock.dirty = true;
+            onUpdate();
+        }
     }
 
     void cameraMenu(FrameInterpolator *frameInterpolator)
@@ -312,6 +1006,7 @@ public:
         if (updateCamera)
         {
             camera.onUpdate();
+            cameraBlock.dirty = true;
             onUpdate();
         }
     }
@@ -325,24 +1020,125 @@ public:
     void mouseDragCallback(ImVec2 dpos)
     {
         camera.mouseDragCallback(glm::vec2(dpos.x, dpos.y));
+        cameraBlock.dirty = true;
         onUpdate();
     }
 
     void mouseScrollCallback(float yOffset)
     {
         camera.mouseScrollCallback(yOffset);
+        cameraBlock.dirty = true;
         onUpdate();
     }
 
 private:
 
+    // Settings compiled into the scene shader, one bit per define of a variant in the order given to `setFeatures`
+    enum SceneFeature
+    {
+        FEATURE_TEST = 1 << 0,
+        FEATURE_PIXEL_SAMPLING = 1 << 1,
+        FEATURE_JITTERED_GRID_SAMPLING = 1 << 2,
+        FEATURE_GRID_SAMPLING = 1 << 3,
+        FEATURE_GAMMA_CORRECTION = 1 << 4,
+        FEATURE_TEMPORAL_ANTI_ALIASING = 1 << 5
+    };
+
+    // The define of each bit, in order
+    static inline const std::vector<std::string> SCENE_FEATURES = { "TEST", "PIXEL_SAMPLING", "JITTERED_GRID_SAMPLING", "GRID_SAMPLING", "GAMMA_CORRECTION", "TEMPORAL_ANTI_ALIASING" };
+
+    // Uniforms that change from one pass or draw to the next
+    struct SceneUniforms
+    {
+        Shader::Uniform<bool> doSingleSample, doLayers;
+        Shader::Uniform<int> checkerboardParity, renderedFrameCount, prevFrameTexture;
+        Shader::Uniform<float> u_time;
+        Shader::Uniform<glm::vec2> upsamplingJitter;
+    };
+
+    // The same for the compute backend, which also reads the stage it's dispatched for
+    struct ComputeUniforms
+    {
+        Shader::Uniform<int> renderedFrameCount, prevFrameTexture, stage, raysPerInvocation;
+        Shader::Uniform<float> u_time;
+        Shader::Uniform<glm::ivec4> region;
+    };
+
+    // * std140 mirrors of the uniform blocks in main.frag, vec3s are padded to 16 bytes and bools are 4
+
+    enum BlockBinding { RENDERING_BINDING, FRACTAL_BINDING, WORLD_BINDING, CAMERA_BINDING, MATERIAL_BINDING, LIGHT_BINDING };
+
+    struct RenderingBlock
+    {
+        glm::ivec2 resolution;
+        GLint samplesPerPixel;
+        GLint doCheckerboard, doUpsampling, doPacketMarching;
+        float upsamplingScale, padding;
+    };
+
+    struct FractalBlock
+    {
+        glm::vec4 c;
+        GLint maxIterations;
+        float w, boundingRadius2, escapeThreshold, epsilon, padding[3];
+    };
+
+    struct WorldBlock
+    {
+        glm::vec3 backgroundLinear; float padding;
+    };
+
+    struct CameraBlock
+    {
+        glm::vec3 lookfrom; float cameraDistance;
+        glm::vec3 pixelDW; float padding0;
+        glm::vec3 pixelDH; float padding1;
+        glm::vec3 viewportOrigin; float padding2;
+    };
+
+    struct MaterialBlock
+    {
+        float roughnessA2, roughnessK, padding0[2];
+        glm::vec3 diffuse; float padding1;
+        glm::vec3 F0; float padding2;
+    };
+
+    struct LightBlock
+    {
+        glm::vec3 lightPos; float padding0;
+        glm::vec3 lightRadiance; float padding1;
+    };
+
     Camera camera;
+    Camera lastPassCamera;  // Camera the previous pass was rendered with, for reprojection
     Shader shader;
+    Shader *sceneShader = nullptr;  // Variant of `shader` bound last
+    int sceneShaderVersion = 0;     // Of `sceneShader` when its uniforms were resolved
+    unsigned passFeatures = 0;      // Of the variant the current pass is drawn with
+    SceneUniforms uniforms;         // Of `sceneShader`, set on every pass
+    UniformBlock<RenderingBlock> renderingBlock;
+    UniformBlock<FractalBlock> fractalBlock;
+    UniformBlock<WorldBlock> worldBlock;
+    UniformBlock<CameraBlock> cameraBlock;  // Also read by the checkerboard resolve
+    UniformBlock<MaterialBlock> materialBlock;
+    UniformBlock<LightBlock> lightBlock;
+    Shader computeShader;           // Scene shader of the compute backend, with the same variants
+    Shader *computeVariant = nullptr;  // Variant of `computeShader` dispatched last
+    int computeVariantVersion = 0;     // Of `computeVariant` when its uniforms were resolved
+    ComputeUniforms computeUniforms;   // Of `computeVariant`
+    GLuint rayQueue = 0;            // Pixels the compute backend's classify stage left to shade
+    GLsizeiptr rayQueueSize = 0;
+    GLuint maxComputeGroups = 65535;  // In one dispatch along x, 65535 is the least GL 4.3 allows
+    Shader checkerboardShader;
+    Shader upsampleShader;
+    Shader edgeShader;
     Material mat;
     Light light;
 
     // States
     int skipAA = 0;
+    int sceneVersion = 0;
+    int guideSceneVersion = -1;
     bool doTemporalAntiAliasing = true;
     bool doTAA = true;
     
@@ -353,7 +1149,23 @@ private:
     bool test = false;
     bool doGammaCorrection = true;
     bool doPixelSampling = true;
+    bool doCheckerboard = false;
+    int checkerboardParity = 0;
+    bool doUpsampling = false;
+    bool doPacketMarching = true;
+    bool canCompute = false;
+    bool doCompute = false;
+    int raysPerInvocation = 4;   // Most the compute backend shades per invocation, llvmpipe cuts off any over 65535 loop iterations
+    bool doEdgeSampling = false;
+    bool showEdges = false;
+    float edgeDepthThreshold = 0.02f;
+    float edgeNormalThreshold = 0.95f;
+    float upsamplingScale = 0.5f;
+    glm::vec2 upsamplingJitter = glm::vec2(0.0f);
     glm::ivec2 resolution;
+    glm::ivec2 lastPassResolution;
+    int lastPassFrameCount = 0;
+    bool drawingStaleVariant = false;  // Passes are drawn with the last variant while the one for the settings builds
 
     // Fractal settings
     int maxIterations = 10;
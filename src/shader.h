@@ -3,109 +3,241 @@
 
 #include <GL/glew.h>
 #include <string>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <unordered_map>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "shaderCompiler.h"
+#include "embeddedShaders.h"
 
 class Shader
 {
 public:
 
-    GLuint ID;
+    // Location of a uniform resolved once after linking, set through the type it was declared with
+    template <typename T>
+    class Uniform
+    {
+    public:
+
+        GLint location = -1;
+
+        void set(const T &value) const
+        {
+            if (location != -1) upload(location, value);
+        }
+
+    };
+
+    // Builds programs in the background when set, otherwise every program is compiled where it's asked for
+    static inline ShaderCompiler *compiler = nullptr;
+
+    // Shaders are read from the files in here when it's set, instead of the sources embedded in the binary
+    static inline std::string sourceDirectory;
+
     bool validateUniform = false;
 
     Shader() {}
 
-    Shader(const char *vertexPath, const char *fragmentPath)
+    // Shaders are named by their file in src/shaders
+    Shader(const char *vertexName, const char *fragmentName)
     {
-        // Retrieve the vertex and fragment shader code from filepaths
-        std::string vertexCode, fragmentCode;
-        std::ifstream vShaderFile, fShaderFile;
+        program->vertexName = vertexName;
+        program->fragmentName = fragmentName;
+        compile();
+        getPrograms().push_back(program);
+    }
 
-        // Ensure ifstream objects can throw exceptions
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            // Open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
+    // A compute program, which needs a GL 4.3 context
+    explicit Shader(const char *computeName)
+    {
+        program->fragmentName = computeName;
+        compile();
+        getPrograms().push_back(program);
+    }
 
-            // Read file contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
+    // Compiled in the variants of `features` that are asked for, nothing is built until then. A compute program has
+    // an empty `vertexName`
+    Shader(const char *vertexName, const char *fragmentName, const std::vector<std::string> &features)
+    {
+        program->vertexName = vertexName;
+        program->fragmentName = fragmentName;
+        setFeatures(features);
+    }
 
-            // Close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
+    void use()
+    {
+        glUseProgram(program->ID);
+    }
+
+    GLuint getID() const
+    {
+        return program->ID;
+    }
+
+    // Of the preprocessed sources the program was last built from, without its variant's defines so every variant
+    // of a shader has the same. It changes when the sources are edited and reloaded
+    uint64_t getSourceHash() const
+    {
+        return program->filesHash;
+    }
+
+    // Changes whenever the program is replaced by a reload, uniform locations resolved before then are stale
+    int getVersion() const
+    {
+        return program->version;
+    }
 
-            // Convert code into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
+    // Resolve `name` into `uniform`, checking it exists and has a matching type so mistakes show up at startup
+    template <typename T>
+    void getUniform(const char *name, Uniform<T> &uniform) const
+    {
+        uniform.location = -1;
+
+        auto found = program->uniforms.find(name);
+        if (found == program->uniforms.end())
+        {
+            // The compiler drops uniforms that don't affect the output, which is only an error when validating
+            if (validateUniform)
+            {
+                std::cerr << "Error: Uniform `" << name << "` not found." << std::endl;
+                exit(1);
+            }
+            return;
         }
-        catch (std::ifstream::failure e)
+
+        if (!matchesType(found->second.type, T()))
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+            std::cerr << "Error: Uniform `" << name << "` is set with the wrong type." << std::endl;
+            exit(1);
         }
-        const char *vShaderCode = vertexCode.c_str();
-        const char *fShaderCode = fragmentCode.c_str();
 
-        // Compile vertex shader
-        GLuint vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
+        uniform.location = found->second.location;
+    }
 
-        // Check for vertex shader compilation errors
-        GLint success;
-        char infoLog[512];
-        glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-        if (!success)
+    // Read uniform block `name` from `binding`, checking a `size` byte buffer holds all of it. The binding is kept
+    // with the program, so variants and reloads of it read the block from the same place
+    void bindBlock(const char *name, GLuint binding, size_t size) const
+    {
+        if (validateUniform && program->ID && glGetUniformBlockIndex(program->ID, name) == GL_INVALID_INDEX)
         {
-            glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-            std::cerr << "ERROR::VERTEX_SHADER::COMPILATION_FAILED\n" << infoLog << std::endl;
+            std::cerr << "Error: Uniform block `" << name << "` not found." << std::endl;
             exit(1);
         }
 
-        // Compile fragment shader
-        GLuint fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
+        BlockBinding block = { name, binding, size };
+        std::vector<BlockBinding> &blocks = program->blocks;
+        auto found = std::find_if(blocks.begin(), blocks.end(), [name](const BlockBinding &other) { return other.name == name; });
+        if (found == blocks.end()) blocks.push_back(block);
+        else *found = block;
+
+        bindBlock(*program, block);
+    }
+
+    // * Permutations
+
+    // Name the feature flags the program can be compiled with. Bit i of a variant's flags defines `names[i]`, so
+    // the shader can test the flag in the preprocessor or fold it as a constant instead of branching per pixel
+    void setFeatures(const std::vector<std::string> &names)
+    {
+        permutations = std::make_shared<Permutations>();
+        permutations->features = names;
+
+        // A program compiled already is the one without flags
+        if (!program->ID) return;
+        permutations->variants[0] = std::make_unique<Shader>(*this);
+        permutations->variants[0]->permutations = nullptr;
+    }
+
+    // The program for `flags`, compiled the first time it's asked for and shared by every copy of this shader.
+    // Waits for the variant if it's being built in the background. Nothing is returned if it doesn't build, its
+    // errors are shown and it's built again when a file it's made of changes
+    Shader *getVariant(unsigned flags)
+    {
+        Shader *variant = findVariant(flags);
+        if (variant) return variant;
 
-        // Check for vertex shader compilation errors
-        glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-        if (!success)
+        Program &variantProgram = *permutations->variants[flags]->program;
+        if (variantProgram.job)
         {
-            glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-            std::cerr << "ERROR::FRAGMENT_SHADER::COMPILATION_FAILED\n" << infoLog << std::endl;
-            exit(1);
+            std::string shownError;
+            if (compiler) compiler->wait(variantProgram.job);
+            updateProgram(variantProgram, shownError);
         }
 
-        // Create shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
+        // A variant that failed in the background showed its errors then
+        return variantProgram.ID ? permutations->variants[flags].get() : nullptr;
+    }
+
+    // The program for `flags` if it's ready to draw with, otherwise it starts building in the background and
+    // nothing is returned until it's done
+    Shader *findVariant(unsigned flags)
+    {
+        std::unique_ptr<Shader> &variant = permutations->variants[flags];
+        if (variant) return variant->program->ID ? variant.get() : nullptr;
 
-        // Check for linking errors
-        glGetProgramiv(ID, GL_LINK_STATUS, &success);
-        if (!success)
+        std::string defines;
+        for (size_t i = 0; i < permutations->features.size(); i++)
         {
-            glGetProgramInfoLog(ID, 512, NULL, infoLog);
-            std::cerr << "ERROR::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-            exit(1);
+            if (flags & (1u << i)) defines += "#define " + permutations->features[i] + "\n";
         }
 
-        // Cleanup
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+        variant = std::make_unique<Shader>();
+        variant->validateUniform = validateUniform;
+        variant->program->vertexName = program->vertexName;
+        variant->program->fragmentName = program->fragmentName;
+        variant->program->defines = defines;
+        variant->program->blocks = program->blocks;
+        getPrograms().push_back(variant->program);
+
+        rebuild(*variant->program);
+        if (compiler) return nullptr;
+
+        // Built already, a variant that fails shows its errors like one that fails in the background
+        std::string shownError;
+        updateProgram(*variant->program, shownError);
+        return variant->program->ID ? variant.get() : nullptr;
     }
 
-    void use()
+    // * Reloading
+
+    // Rebuild in the background every program made from file `name`, directly or through an include. They are
+    // swapped in by `update` once they link
+    static void reload(const std::string &name)
     {
-        glUseProgram(ID);
+        for (auto &weakProgram : getPrograms())
+        {
+            std::shared_ptr<Program> program = weakProgram.lock();
+            if (!program) continue;
+
+            const std::vector<std::string> &vertexFiles = program->vertexFiles, &fragmentFiles = program->fragmentFiles;
+            if (std::find(vertexFiles.begin(), vertexFiles.end(), name) != vertexFiles.end() || std::find(fragmentFiles.begin(), fragmentFiles.end(), name) != fragmentFiles.end())
+                rebuild(*program);
+        }
+    }
+
+    // Swap in the programs that finished building since the last frame, true if any was replaced. A program that
+    // fails keeps the one it had
+    static bool update()
+    {
+        if (compiler) compiler->update();
+
+        std::vector<std::weak_ptr<Program>> &programs = getPrograms();
+        programs.erase(std::remove_if(programs.begin(), programs.end(), [](const std::weak_ptr<Program> &program) { return program.expired(); }), programs.end());
+        // The variants of a program fail together, possibly in different frames, their error is only shown once
+        bool replaced = false;
+        static std::string shownError;
+        for (auto &weakProgram : programs)
+        {
+            std::shared_ptr<Program> program = weakProgram.lock();
+            if (program->job && program->job->done) replaced = updateProgram(*program, shownError) || replaced;
+        }
+        return replaced;
     }
     
 
@@ -232,19 +364,346 @@ public:
 
 private:
 
+    struct BlockBinding
+    {
+        std::string name;
+        GLuint binding;
+        size_t size;
+    };
+
+    struct ActiveUniform
+    {
+        GLint location;
+        GLenum type;
+    };
+
+    // The linked program and everything needed to build it again, shared by copies of the shader so they all
+    // draw with the new program after a reload
+    struct Program
+    {
+        GLuint ID = 0;
+        int version = 0;
+        std::string vertexName, fragmentName;  // A compute program has no vertex shader and its shader in place of the fragment shader
+        std::string defines;  // Of the variant, added to the fragment source
+        std::vector<std::string> vertexFiles, fragmentFiles;  // Every file pasted into each source, by source string number
+        uint64_t sourceHash = 0;  // Of the preprocessed sources it was last built from
+        uint64_t filesHash = 0;   // Of the same sources before the defines were added
+        std::unordered_map<std::string, ActiveUniform> uniforms;  // Every active uniform of the linked program by name
+        std::vector<BlockBinding> blocks;
+        std::shared_ptr<ShaderCompiler::Job> job;  // The program being built to replace this one
+        bool rebuildQueued = false;  // The files changed again while it was being built
+    };
+
+    // Everything the variants of one program share
+    struct Permutations
+    {
+        std::vector<std::string> features;
+        std::unordered_map<unsigned, std::unique_ptr<Shader>> variants;
+    };
+
+    static constexpr int LINES_PER_FILE = 100000;
+
+    std::shared_ptr<Program> program = std::make_shared<Program>();
+    std::shared_ptr<Permutations> permutations;
+
+    // Every program built so far, to find the ones a changed file belongs to
+    static std::vector<std::weak_ptr<Program>> &getPrograms()
+    {
+        static std::vector<std::weak_ptr<Program>> programs;
+        return programs;
+    }
+
+    // Retrieve the code of shader `name`, from the binary unless a directory overrides it
+    static std::string readSource(const std::string &name)
+    {
+        if (sourceDirectory.empty())
+        {
+            for (const EmbeddedShader &shader : EMBEDDED_SHADERS)
+            {
+                if (name == shader.name) return shader.source;
+            }
+            std::cerr << "ERROR::SHADER::NOT_EMBEDDED " << name << std::endl;
+            return "";
+        }
+
+        std::string path = sourceDirectory + "/" + name;
+        std::ifstream file;
+
+        // Ensure ifstream objects can throw exceptions
+        file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            std::stringstream stream;
+            file.open(path);
+            stream << file.rdbuf();
+            file.close();
+            return stream.str();
+        }
+        catch (std::ifstream::failure &e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+            return "";
+        }
+    }
+
+    // The preprocessed sources of `program`, with the variant's defines after #version, which has to stay first.
+    // The files they're made of are kept with the program, to reload it when any of them changes
+    static void readSources(Program &program, std::string &vertexCode, std::string &fragmentCode)
+    {
+        program.vertexFiles.clear();
+        program.fragmentFiles.clear();
+        vertexCode = program.vertexName.empty() ? "" : preprocess(program.vertexName, program.vertexFiles);
+        fragmentCode = preprocess(program.fragmentName, program.fragmentFiles);
+        program.filesHash = hashBytes(fragmentCode.data(), fragmentCode.size(), hashBytes(vertexCode.data(), vertexCode.size()));
+        if (program.defines.empty()) return;
+
+        // #line keeps the line numbers of errors those of the file
+        size_t versionEnd = fragmentCode.find('\n', fragmentCode.find("#version"));
+        if (versionEnd == std::string::npos) versionEnd = fragmentCode.size();
+        int nextLine = 2 + (int)std::count(fragmentCode.begin(), fragmentCode.begin() + versionEnd, '\n');
+        fragmentCode.insert(versionEnd, "\n" + program.defines + "#line " + std::to_string(nextLine) + " 0");
+    }
+
+    // Shader `name` with the files it includes pasted in place of their #include "file". A file is only pasted the
+    // first time it's included, as if guarded, and `files` lists them in order. Includes are resolved before the
+    // GLSL preprocessor runs, so one inside an #if is pasted anyway.
+    // Some drivers leave the source string number of #line out of their logs, so the line numbers of file i start
+    // at i*LINES_PER_FILE + 1 instead, which is enough to tell where an error is from its line number alone
+    static std::string preprocess(const std::string &name, std::vector<std::string> &files)
+    {
+        int sourceNumber = (int)files.size();
+        files.push_back(name);
+
+        std::istringstream source(readSource(name));
+        std::string line, included, output;
+        for (int lineNumber = 1; std::getline(source, line); lineNumber++)
+        {
+            if (!parseInclude(line, included))
+            {
+                output += line + "\n";
+                continue;
+            }
+
+            if (std::find(files.begin(), files.end(), included) == files.end())
+            {
+                output += "#line " + std::to_string(files.size()*LINES_PER_FILE + 1) + " " + std::to_string(files.size()) + "\n";
+                output += preprocess(included, files);
+            }
+            output += "#line " + std::to_string(sourceNumber*LINES_PER_FILE + lineNumber + 1) + " " + std::to_string(sourceNumber) + "\n";
+        }
+        return output;
+    }
+
+    // Whether `line` is an #include "file" directive, with the file's name in `name`
+    static bool parseInclude(const std::string &line, std::string &name)
+    {
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line.compare(start, 8, "#include") != 0) return false;
+
+        size_t open = line.find('"', start + 8);
+        if (open == std::string::npos) return false;
+        size_t close = line.find('"', open + 1);
+        if (close == std::string::npos) return false;
+
+        name = line.substr(open + 1, close - open - 1);
+        return true;
+    }
+
+    // A compile log with the file and its line in place of the source string number and line each of its lines
+    // starts with, as in 0:100014(5) or 0(100014)
+    static std::string nameSourceFiles(const std::string &error, const Program &program)
+    {
+        bool vertex = error.compare(0, 22, "ERROR::VERTEX_SHADER::") == 0;
+        const std::vector<std::string> &files = vertex ? program.vertexFiles : program.fragmentFiles;
+
+        std::istringstream lines(error);
+        std::string line, output;
+        while (std::getline(lines, line))
+        {
+            size_t start = line.compare(0, 7, "ERROR: ") == 0 ? 7 : 0;
+            size_t numberEnd = line.find_first_not_of("0123456789", start);
+            size_t lineEnd = numberEnd == std::string::npos ? numberEnd : line.find_first_not_of("0123456789", numberEnd + 1);
+            if (numberEnd != std::string::npos && numberEnd > start && (line[numberEnd] == ':' || line[numberEnd] == '(') && lineEnd != std::string::npos && lineEnd > numberEnd + 1)
+            {
+                long location = std::stol(line.substr(numberEnd + 1, lineEnd - numberEnd - 1));
+                size_t file = location / LINES_PER_FILE;
+                if (file < files.size())
+                    line = line.substr(0, start) + files[file] + line[numberEnd] + std::to_string(location % LINES_PER_FILE) + line.substr(lineEnd);
+            }
+            output += line + "\n";
+        }
+        return output;
+    }
+
+    // Compile and link the program here and now, a program that doesn't build is fatal
+    void compile()
+    {
+        std::string vertexCode, fragmentCode, error;
+        readSources(*program, vertexCode, fragmentCode);
+        program->sourceHash = hashBytes(fragmentCode.data(), fragmentCode.size(), hashBytes(vertexCode.data(), vertexCode.size()));
+
+        ShaderCompiler::Build build = ShaderCompiler::begin(vertexCode, fragmentCode);
+        if (!ShaderCompiler::finish(build, error))
+        {
+            std::cerr << nameSourceFiles(error, *program) << std::endl;
+            exit(1);
+        }
+
+        setProgram(*program, build.program);
+    }
+
+    // Start building `program` again from its files. If it's already being built, it's built once more when that's done
+    static void rebuild(Program &program)
+    {
+        if (program.job)
+        {
+            program.rebuildQueued = true;
+            return;
+        }
+
+        // Saving a file without changing what the program is made of doesn't build it again
+        std::string vertexCode, fragmentCode;
+        readSources(program, vertexCode, fragmentCode);
+        uint64_t hash = hashBytes(fragmentCode.data(), fragmentCode.size(), hashBytes(vertexCode.data(), vertexCode.size()));
+        if (hash == program.sourceHash) return;
+        program.sourceHash = hash;
+
+        if (compiler)
+        {
+            program.job = compiler->submit(vertexCode, fragmentCode);
+            return;
+        }
+
+        ShaderCompiler::Build build = ShaderCompiler::begin(vertexCode, fragmentCode);
+        program.job = std::make_shared<ShaderCompiler::Job>();
+        program.job->program = ShaderCompiler::finish(build, program.job->error);
+        program.job->done = true;
+    }
+
+    // Take the result of `program`'s finished job, true if it replaced a program, which is deleted. Its error is
+    // shown unless it's `shownError`, which becomes the last one shown until a program builds again
+    static bool updateProgram(Program &program, std::string &shownError)
+    {
+        std::shared_ptr<ShaderCompiler::Job> job = program.job;
+        program.job = nullptr;
+
+        bool replaced = false;
+        if (job->program)
+        {
+            replaced = program.ID != 0;
+            if (replaced) glDeleteProgram(program.ID);
+            setProgram(program, job->program);
+            program.version++;
+            shownError.clear();
+        }
+        else if (job->error != shownError)
+        {
+            std::cerr << nameSourceFiles(job->error, program) << std::endl;
+            if (program.ID) std::cerr << "Keeping the previous program of " << program.fragmentName << std::endl;
+            shownError = job->error;
+        }
+
+        // The files were saved again while it was being built
+        if (program.rebuildQueued)
+        {
+            program.rebuildQueued = false;
+            rebuild(program);
+        }
+        return replaced;
+    }
+
+    // Make `ID` the linked program of `program`, every uniform and block is looked up once here
+    static void setProgram(Program &program, GLuint ID)
+    {
+        program.ID = ID;
+        loadUniforms(program);
+        for (const BlockBinding &block : program.blocks)
+            bindBlock(program, block);
+    }
+
+    // A program still being built is bound by `setProgram` once it links
+    static void bindBlock(const Program &program, const BlockBinding &block)
+    {
+        if (!program.ID) return;
+
+        GLuint index = glGetUniformBlockIndex(program.ID, block.name.c_str());
+        if (index == GL_INVALID_INDEX) return;
+
+        GLint blockSize = 0;
+        glGetActiveUniformBlockiv(program.ID, index, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+        if ((size_t)blockSize > block.size)
+        {
+            std::cerr << "Error: Uniform block `" << block.name << "` is " << blockSize << " bytes, larger than its " << block.size << " byte buffer." << std::endl;
+            exit(1);
+        }
+
+        glUniformBlockBinding(program.ID, index, block.binding);
+    }
+
+    // Ask the program for all its uniforms once, rather than looking one up on every set
+    static void loadUniforms(Program &program)
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(program.ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(program.ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+        program.uniforms.clear();
+        std::string name(glm::max(maxLength, 1), '\0');
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(program.ID, (GLuint)i, maxLength, &length, &size, &type, &name[0]);
+
+            // Uniforms in blocks have no location of their own
+            std::string uniformName = name.substr(0, length);
+            GLint location = glGetUniformLocation(program.ID, uniformName.c_str());
+            if (location == -1) continue;
+
+            // Arrays are listed as their first element, but set by the array's name
+            if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+                uniformName.resize(uniformName.size() - 3);
+            program.uniforms[uniformName] = { location, type };
+        }
+    }
+
     GLint getLocation(const std::string &name) const
     {
-        GLint location = glGetUniformLocation(ID, name.c_str());
+        auto found = program->uniforms.find(name);
+        if (found != program->uniforms.end()) return found->second.location;
 
-        if (location == -1 && validateUniform)
+        if (validateUniform)
         {
             std::cerr << "Error: Uniform `" << name << "` not found." << std::endl;
             exit(1);
         }
 
-        return location;
+        return -1;
     }
 
+    // * Typed uploads and the GLSL types each C++ type may set
+
+    static void upload(GLint location, GLfloat value)            { glUniform1f(location, value); }
+    static void upload(GLint location, const glm::vec2 &value)   { glUniform2fv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::vec3 &value)   { glUniform3fv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::vec4 &value)   { glUniform4fv(location, 1, &value[0]); }
+    static void upload(GLint location, GLint value)              { glUniform1i(location, value); }
+    static void upload(GLint location, const glm::ivec2 &value)  { glUniform2iv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::ivec3 &value)  { glUniform3iv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::ivec4 &value)  { glUniform4iv(location, 1, &value[0]); }
+    static void upload(GLint location, bool value)               { glUniform1i(location, (GLint)value); }
+
+    static bool matchesType(GLenum type, GLfloat)      { return type == GL_FLOAT; }
+    static bool matchesType(GLenum type, glm::vec2)    { return type == GL_FLOAT_VEC2; }
+    static bool matchesType(GLenum type, glm::vec3)    { return type == GL_FLOAT_VEC3; }
+    static bool matchesType(GLenum type, glm::vec4)    { return type == GL_FLOAT_VEC4; }
+    static bool matchesType(GLenum type, GLint)        { return type == GL_INT || type == GL_SAMPLER_2D; }
+    static bool matchesType(GLenum type, glm::ivec2)   { return type == GL_INT_VEC2; }
+    static bool matchesType(GLenum type, glm::ivec3)   { return type == GL_INT_VEC3; }
+    static bool matchesType(GLenum type, glm::ivec4)   { return type == GL_INT_VEC4; }
+    static bool matchesType(GLenum type, bool)         { return type == GL_BOOL; }
+
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,392 @@
+#ifndef SHADER_COMPILER_H
+#define SHADER_COMPILER_H
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <filesystem>
+#include <iostream>
+#include <glm/glm.hpp>
+#include "utils.h"
+
+// Compiles and links programs, through an on-disk cache of linked binaries. Submitted programs are built on a worker
+// thread with a context sharing objects with the window's, so the render loop never waits on the driver
+class ShaderCompiler
+{
+public:
+
+    // Names the app's directory in the user's cache directory, where linked programs are kept between runs so startup
+    // only compiles what changed
+    static constexpr const char *CACHE_NAME = "quaternion-julia-sets";
+
+    // A program whose compile and link have been started
+    struct Build
+    {
+        GLuint program = 0;
+        GLuint vertex = 0, fragment = 0;  // 0 when the program was loaded from the cache, compute programs only have `fragment`
+        std::string cachePath;
+    };
+
+    // A program built in the background, `program` is 0 if it failed and `error` says why
+    struct Job
+    {
+        std::string vertexCode, fragmentCode;
+        Build build;
+        GLuint program = 0;
+        std::string error;
+        std::atomic<bool> done = false;
+    };
+
+    ShaderCompiler() {}
+
+    // Start the worker with a hidden window sharing `window`'s objects, without one jobs are built on this thread
+    void init(GLFWwindow *window)
+    {
+        startParallelCompile();
+
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        context = glfwCreateWindow(1, 1, "Shader compiler", NULL, window);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        if (!context)
+        {
+            std::cerr << "Could not create the shader compiler context, shaders are compiled on the render thread" << std::endl;
+            return;
+        }
+
+        stopping = false;
+        worker = std::thread(&ShaderCompiler::run, this);
+    }
+
+    void stop()
+    {
+        if (worker.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            queued.notify_all();
+            worker.join();
+        }
+        if (context) glfwDestroyWindow(context);
+        context = nullptr;
+    }
+
+    std::shared_ptr<Job> submit(const std::string &vertexCode, const std::string &fragmentCode)
+    {
+        auto job = std::make_shared<Job>();
+        job->vertexCode = vertexCode;
+        job->fragmentCode = fragmentCode;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(job);
+        }
+        queued.notify_one();
+        return job;
+    }
+
+    // Without a worker the jobs are built here once per frame, and with parallel compilation only collected when
+    // the driver is done with them
+    void update()
+    {
+        if (worker.joinable()) return;
+
+        for (size_t i = 0; i < pending.size(); )
+        {
+            Job &job = *pending[i];
+            if (!job.build.program) job.build = begin(job.vertexCode, job.fragmentCode);
+            if (isFinished(job.build))
+            {
+                job.program = finish(job.build, job.error);
+                job.done = true;
+                pending.erase(pending.begin() + i);
+            }
+            else i++;
+        }
+    }
+
+    // Block until `job` is built
+    void wait(const std::shared_ptr<Job> &job)
+    {
+        if (job->done) return;
+
+        if (worker.joinable())
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&job] { return job->done.load(); });
+            return;
+        }
+
+        if (!job->build.program) job->build = begin(job->vertexCode, job->fragmentCode);
+        job->program = finish(job->build, job->error);
+        job->done = true;
+        pending.erase(std::find(pending.begin(), pending.end(), job));
+    }
+
+
+    // * Building a program
+
+    // Let the driver compile on its own threads, so compiles and links only block when their result is asked for
+    static void startParallelCompile()
+    {
+        if (GLEW_KHR_parallel_shader_compile) glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        else if (GLEW_ARB_parallel_shader_compile) glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    }
+
+    // Start linking the program from its cached binary, or else compiling it from source. A program without vertex
+    // code is a compute program, with the compute shader in place of the fragment shader
+    static Build begin(const std::string &vertexCode, const std::string &fragmentCode)
+    {
+        Build build;
+        if (canCacheBinaries())
+        {
+            build.cachePath = getCachePath(vertexCode, fragmentCode);
+            build.program = loadBinary(build.cachePath);
+            if (build.program) return build;
+        }
+
+        const char *vShaderCode = vertexCode.c_str();
+        const char *fShaderCode = fragmentCode.c_str();
+
+        if (!vertexCode.empty())
+        {
+            build.vertex = glCreateShader(GL_VERTEX_SHADER);
+            glShaderSource(build.vertex, 1, &vShaderCode, NULL);
+            glCompileShader(build.vertex);
+        }
+
+        build.fragment = glCreateShader(vertexCode.empty() ? GL_COMPUTE_SHADER : GL_FRAGMENT_SHADER);
+        glShaderSource(build.fragment, 1, &fShaderCode, NULL);
+        glCompileShader(build.fragment);
+
+        build.program = glCreateProgram();
+        if (build.vertex) glAttachShader(build.program, build.vertex);
+        glAttachShader(build.program, build.fragment);
+        if (!build.cachePath.empty()) glProgramParameteri(build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(build.program);
+
+        return build;
+    }
+
+    // Whether asking for the result of `build` would block, drivers without parallel compilation always say no
+    static bool isFinished(const Build &build)
+    {
+        if (!GLEW_KHR_parallel_shader_compile && !GLEW_ARB_parallel_shader_compile) return true;
+
+        GLint complete = GL_TRUE;
+        glGetProgramiv(build.program, GL_COMPLETION_STATUS_KHR, &complete);
+        return complete;
+    }
+
+    // The linked program of `build`, or 0 with the compile or link log in `error`
+    static GLuint finish(Build &build, std::string &error)
+    {
+        if (!build.fragment) return build.program;
+
+        GLint success = GL_TRUE;
+        char infoLog[512];
+        error.clear();
+
+        // Check for compilation and linking errors
+        if (build.vertex) glGetShaderiv(build.vertex, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(build.vertex, 512, NULL, infoLog);
+            error = std::string("ERROR::VERTEX_SHADER::COMPILATION_FAILED\n") + infoLog;
+        }
+
+        glGetShaderiv(build.fragment, GL_COMPILE_STATUS, &success);
+        if (!success && error.empty())
+        {
+            glGetShaderInfoLog(build.fragment, 512, NULL, infoLog);
+            error = std::string(build.vertex ? "ERROR::FRAGMENT_SHADER" : "ERROR::COMPUTE_SHADER") + "::COMPILATION_FAILED\n" + infoLog;
+        }
+
+        glGetProgramiv(build.program, GL_LINK_STATUS, &success);
+        if (!success && error.empty())
+        {
+            glGetProgramInfoLog(build.program, 512, NULL, infoLog);
+            error = std::string("ERROR::PROGRAM::LINKING_FAILED\n") + infoLog;
+        }
+
+        // Cleanup
+        glDeleteShader(build.vertex);
+        glDeleteShader(build.fragment);
+        build.vertex = build.fragment = 0;
+
+        if (!error.empty())
+        {
+            glDeleteProgram(build.program);
+            build.program = 0;
+        }
+        else if (!build.cachePath.empty()) saveBinary(build.program, build.cachePath);
+
+        return build.program;
+    }
+
+private:
+
+    GLFWwindow *context = nullptr;
+    std::thread worker;
+    std::vector<std::shared_ptr<Job>> pending;
+    std::mutex mutex;
+    std::condition_variable queued, finished;
+    bool stopping = false;
+
+    void run()
+    {
+        glfwMakeContextCurrent(context);
+        startParallelCompile();
+
+        while (true)
+        {
+            std::vector<std::shared_ptr<Job>> batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                queued.wait(lock, [this] { return stopping || !pending.empty(); });
+                if (stopping) break;
+                batch.swap(pending);
+            }
+
+            // Every build is started before any is waited on, so a driver compiling in parallel has them all at once
+            for (auto &job : batch) job->build = begin(job->vertexCode, job->fragmentCode);
+            for (auto &job : batch) job->program = finish(job->build, job->error);
+
+            // The render context only sees the programs once they are complete
+            glFinish();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (auto &job : batch) job->done = true;
+            }
+            finished.notify_all();
+        }
+
+        glfwMakeContextCurrent(NULL);
+    }
+
+
+    // * Binary cache
+
+    // Drivers that can't save programs report no binary formats
+    static bool canCacheBinaries()
+    {
+        static const bool supported = []
+        {
+            GLint formatCount = 0;
+            if (GLEW_ARB_get_program_binary || GLEW_VERSION_4_1) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+            return formatCount > 0;
+        }();
+        return supported;
+    }
+
+    // A binary only loads into the driver that made it, so the driver is part of the key along with the source,
+    // which already has the defines of its variant in it
+    static std::string getCachePath(const std::string &vertexCode, const std::string &fragmentCode)
+    {
+        uint64_t hash = hashBytes(vertexCode.data(), vertexCode.size());
+        hash = hashBytes(fragmentCode.data(), fragmentCode.size(), hash);
+        for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+        {
+            const char *driver = (const char*)glGetString(name);
+            if (driver) hash = hashBytes(driver, strlen(driver) + 1, hash);
+        }
+
+        char fileName[32];
+        snprintf(fileName, sizeof(fileName), "%016" PRIx64 ".bin", hash);
+        return getCacheDirectory() + "/" + fileName;
+    }
+
+    // Under $XDG_CACHE_HOME, or ~/.cache without it, so it's the same whichever directory the app is started from.
+    // Only without a home directory does it fall back to the system's temporary directory
+    static const std::string &getCacheDirectory()
+    {
+        static const std::string directory = []
+        {
+            // Relative paths in $XDG_CACHE_HOME are invalid and ignored
+            const char *cacheHome = getenv("XDG_CACHE_HOME");
+            const char *home = getenv("HOME");
+            std::string base;
+            if (cacheHome && cacheHome[0] == '/') base = cacheHome;
+            else if (home && *home) base = std::string(home) + "/.cache";
+            else base = std::filesystem::temp_directory_path().string();
+            return base + "/" + CACHE_NAME + "/shaders";
+        }();
+        return directory;
+    }
+
+    // The program linked from the binary at `path`. A missing file or one the driver rejects, after an update for
+    // instance, gives 0 and the program is compiled from source instead
+    static GLuint loadBinary(const std::string &path)
+    {
+        FILE *file = fopen(path.c_str(), "rb");
+        if (!file) return 0;
+
+        GLenum format = 0;
+        std::vector<char> binary;
+        bool read = fread(&format, sizeof(format), 1, file) == 1;
+        if (read)
+        {
+            long start = ftell(file);
+            fseek(file, 0, SEEK_END);
+            binary.resize(glm::max(ftell(file) - start, 0L));
+            fseek(file, start, SEEK_SET);
+            read = !binary.empty() && fread(binary.data(), 1, binary.size(), file) == binary.size();
+        }
+        fclose(file);
+        if (!read) return 0;
+
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, format, binary.data(), (GLsizei)binary.size());
+
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+
+    // Written to a temporary file first, so another instance or thread never loads half a binary
+    static void saveBinary(GLuint program, const std::string &path)
+    {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+
+        GLenum format = 0;
+        std::vector<char> binary(length);
+        glGetProgramBinary(program, length, &length, &format, binary.data());
+
+        std::error_code error;
+        std::filesystem::create_directories(getCacheDirectory(), error);
+
+        std::string temporaryPath = path + "." + std::to_string(getpid()) + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+        FILE *file = fopen(temporaryPath.c_str(), "wb");
+        bool written = file && fwrite(&format, sizeof(format), 1, file) == 1 && fwrite(binary.data(), 1, length, file) == (size_t)length;
+        if (file) fclose(file);
+
+        if (written) std::filesystem::rename(temporaryPath, path, error);
+        if (!written || error)
+        {
+            std::cerr << "Could not write program binary " << path << std::endl;
+            std::filesystem::remove(temporaryPath, error);
+        }
+    }
+
+};
+
+#endif
@@ -0,0 +1,9 @@
+// * Camera Uniforms
+layout(std140) uniform CameraBlock
+{
+    vec3 lookfrom;
+    float cameraDistance;
+    vec3 pixelDW;
+    vec3 pixelDH;
+    vec3 viewportOrigin;
+};
@@ -0,0 +1,109 @@
+#version 330 core
+
+// * Inputs / Outputs
+in vec2 TexCoords;
+out vec4 FragColour;
+
+// * Rendering Uniforms
+uniform bool doTemporalAntiAliasing;
+uniform int renderedFrameCount;
+uniform int checkerboardParity;
+uniform ivec2 resolution;
+uniform ivec2 prevResolution;
+uniform sampler2D prevFrameTexture;
+uniform sampler2D checkerboardTexture;  // Half-width samples of this frame, depth in alpha
+
+// * Camera Uniforms, shared with the scene shader
+#include "camera.glsl"
+
+// * Previous Camera Uniforms
+uniform vec3 prevLookfrom;
+uniform vec3 prevPixelDW;
+uniform vec3 prevPixelDH;
+uniform vec3 prevViewportOrigin;
+
+// * Checkerboard helpers
+bool isMarched(ivec2 pixel)
+{
+    return ((pixel.x + pixel.y + checkerboardParity) & 1) == 0;
+}
+
+vec4 fetchMarched(ivec2 pixel)
+{
+    // Pixels clamped to the border may land on the wrong colour of the checkerboard
+    pixel = clamp(pixel, ivec2(0), resolution - 1);
+    if (!isMarched(pixel)) pixel.x += (pixel.x == 0) ? 1 : -1;
+
+    return texelFetch(checkerboardTexture, ivec2(pixel.x >> 1, pixel.y), 0);
+}
+
+// * Reprojection
+vec3 worldPosition(vec2 coord, float depth)
+{
+    vec3 pixelSample = viewportOrigin + (coord.x*pixelDW) + (coord.y*pixelDH);
+    return lookfrom + depth*normalize(pixelSample - lookfrom);
+}
+
+bool previousCoord(vec3 P, out vec2 coord)
+{
+    // Intersect the ray from the previous camera to P with the previous viewport plane
+    vec3 normal = cross(prevPixelDW, prevPixelDH);
+    float s = dot(prevViewportOrigin - prevLookfrom, normal) / dot(P - prevLookfrom, normal);
+    if (s <= 0.0) return false;
+
+    vec3 X = prevLookfrom + s*(P - prevLookfrom) - prevViewportOrigin;
+    coord = vec2(dot(X, prevPixelDW) / dot(prevPixelDW, prevPixelDW), dot(X, prevPixelDH) / dot(prevPixelDH, prevPixelDH));
+    return true;
+}
+
+vec3 reconstruct(ivec2 pixel)
+{
+    // Every direct neighbour of a missing pixel was marched this frame
+    vec4 l = fetchMarched(pixel + ivec2(-1, 0));
+    vec4 r = fetchMarched(pixel + ivec2( 1, 0));
+    vec4 d = fetchMarched(pixel + ivec2( 0,-1));
+    vec4 u = fetchMarched(pixel + ivec2( 0, 1));
+    vec3 minColour = min(min(l.rgb, r.rgb), min(d.rgb, u.rgb));
+    vec3 maxColour = max(max(l.rgb, r.rgb), max(d.rgb, u.rgb));
+
+    // Interpolate along the direction with the smaller difference to keep edges sharp
+    bool horizontal = length(l.rgb - r.rgb) < length(d.rgb - u.rgb);
+    vec3 spatial = horizontal ? 0.5*(l.rgb + r.rgb) : 0.5*(d.rgb + u.rgb);
+    vec2 depths = horizontal ? vec2(l.a, r.a) : vec2(d.a, u.a);
+
+    // Silhouettes and background have no single depth to reproject with
+    if (depths.x < 0.0 || depths.y < 0.0) return spatial;
+
+    // Fetch the previous frame at the reprojected position, clamped to the neighbourhood to avoid ghosting
+    vec2 coord;
+    vec3 P = worldPosition(vec2(pixel) + 1.0, 0.5*(depths.x + depths.y));
+    if (!previousCoord(P, coord)) return spatial;
+
+    vec2 prevPixel = coord - 1.0;
+    if (any(lessThan(prevPixel, vec2(0.0))) || any(greaterThanEqual(prevPixel, vec2(prevResolution - 1)))) return spatial;
+
+    vec3 history = texture(prevFrameTexture, (prevPixel + 0.5) / vec2(textureSize(prevFrameTexture, 0))).rgb;
+    return clamp(history, minColour, maxColour);
+}
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec3 prevColour = texelFetch(prevFrameTexture, pixel, 0).rgb;
+    vec3 colour;
+
+    if (isMarched(pixel))
+    {
+        colour = fetchMarched(pixel).rgb;
+
+        // A pixel is only marched every other frame, so it has half as many samples to average with
+        if (doTemporalAntiAliasing) colour = mix(prevColour, colour, 1.0 / (renderedFrameCount/2 + 1));
+    }
+    else
+    {
+        // While accumulating the camera is still, so the history of a missing pixel is already exact
+        colour = doTemporalAntiAliasing ? prevColour : reconstruct(pixel);
+    }
+
+    FragColour = vec4(colour, 1.0);
+}
@@ -0,0 +1,58 @@
+#version 330 core
+
+// * Inputs / Outputs
+in vec2 TexCoords;
+out vec4 FragColour;
+
+// * Denoiser Uniforms
+uniform int stepWidth;              // Distance between the taps of this iteration, doubles every iteration
+uniform float sigmaColour;          // Already scaled down for this iteration
+uniform float sigmaNormal;
+uniform float sigmaDepth;           // Relative depth difference per pixel of distance
+uniform ivec2 resolution;
+uniform sampler2D colourTexture;
+uniform sampler2D guideTexture;     // Normal and depth at the pixel centres, depth is negative on a miss
+
+// B3 spline weights of the 5x5 kernel
+const float KERNEL[3] = float[](3.0/8.0, 1.0/4.0, 1.0/16.0);
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec3 colour = texelFetch(colourTexture, pixel, 0).rgb;
+    vec4 guide = texelFetch(guideTexture, pixel, 0);
+
+    vec3 sum = vec3(0.0);
+    float weightSum = 0.0;
+    for (int y = -2; y <= 2; y++)
+    {
+        for (int x = -2; x <= 2; x++)
+        {
+            ivec2 tap = pixel + ivec2(x, y)*stepWidth;
+            if (any(lessThan(tap, ivec2(0))) || any(greaterThanEqual(tap, resolution))) continue;
+
+            vec3 tapColour = texelFetch(colourTexture, tap, 0).rgb;
+            vec4 tapGuide = texelFetch(guideTexture, tap, 0);
+
+            // Never blend the surface with the background
+            if ((guide.w < 0.0) != (tapGuide.w < 0.0)) continue;
+
+            vec3 dc = tapColour - colour;
+            float weight = KERNEL[abs(x)]*KERNEL[abs(y)] * exp(-dot(dc, dc) / (sigmaColour*sigmaColour));
+
+            // Edge stopping on creases and depth discontinuities
+            if (guide.w >= 0.0)
+            {
+                float distance = length(vec2(x, y)) * float(stepWidth);
+                weight *= pow(max(dot(guide.xyz, tapGuide.xyz), 0.0), sigmaNormal);
+                weight *= exp(-abs(tapGuide.w - guide.w) / (sigmaDepth*guide.w*distance + 1e-6));
+            }
+
+            sum += weight*tapColour;
+            weightSum += weight;
+        }
+    }
+
+    // The centre tap always has a positive weight
+    FragColour = vec4(sum / weightSum, 1.0);
+}
@@ -0,0 +1,48 @@
+#version 330 core
+
+// * Inputs / Outputs
+in vec2 TexCoords;
+out vec4 FragColour;
+
+// * Rendering Uniforms
+uniform bool showEdges;
+uniform float edgeDepthThreshold;   // Relative depth difference between neighbours that counts as an edge
+uniform float edgeNormalThreshold;  // Cosine of the angle between neighbouring normals that counts as an edge
+uniform ivec2 resolution;
+uniform sampler2D sampleTexture;    // Single sample per pixel
+uniform sampler2D gBufferTexture;   // Normal and depth of that sample, depth is negative on a miss
+
+// * Edge detection
+bool isEdge(ivec2 pixel)
+{
+    vec4 centre = texelFetch(gBufferTexture, pixel, 0);
+
+    for (int y = -1; y <= 1; y++)
+    {
+        for (int x = -1; x <= 1; x++)
+        {
+            ivec2 neighbourPixel = clamp(pixel + ivec2(x, y), ivec2(0), resolution - 1);
+            vec4 neighbour = texelFetch(gBufferTexture, neighbourPixel, 0);
+
+            // Silhouettes against the background
+            if ((centre.w < 0.0) != (neighbour.w < 0.0)) return true;
+            if (centre.w < 0.0) continue;
+
+            // Depth discontinuities and creases
+            if (abs(neighbour.w - centre.w) > edgeDepthThreshold*centre.w) return true;
+            if (dot(neighbour.xyz, centre.xyz) < edgeNormalThreshold) return true;
+        }
+    }
+
+    return false;
+}
+
+void main()
+{
+    // Smooth pixels keep their single sample, edges are discarded and left for the supersampling pass
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    bool edge = isEdge(pixel);
+    if (edge && !showEdges) discard;
+
+    FragColour = edge ? vec4(1.0, 0.0, 0.0, 1.0) : vec4(texelFetch(sampleTexture, pixel, 0).rgb, 1.0);
+}
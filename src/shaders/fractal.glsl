@@ -0,0 +1,69 @@
+// Bounding sphere and distance estimate of the quaternion Julia set. Shared with the CPU through juliaKernel.h, so
+// only GLSL that glm also compiles. Reads c, maxIterations, boundingRadius2 and escapeThreshold from the includer
+
+// Parameters the function writes to, a reference in C++
+#ifndef INOUT
+#define INOUT(type) inout type
+#endif
+
+// * Bounding sphere
+float hitSphere(Ray r)
+{
+    vec3 oc = -r.pos;
+    float a = length2(r.dir);
+    float h = dot(r.dir, oc);
+    float c = length2(oc) - boundingRadius2;
+    float discriminant = h*h - a*c;
+
+    if (discriminant < 0.0f)
+        return -1.0f;
+    else
+        return (h - sqrt(discriminant)) / a;
+}
+
+float exitSphere(Ray r)
+{
+    vec3 oc = -r.pos;
+    float a = length2(r.dir);
+    float h = dot(r.dir, oc);
+    float c = length2(oc) - boundingRadius2;
+    float discriminant = h*h - a*c;
+
+    if (discriminant < 0.0f)
+        return -1.0f;
+    else
+        return (h + sqrt(discriminant)) / a;
+}
+
+// * Distance estimation
+float juliaDistanceEstimate(vec4 z, vec4 dz)
+{
+    float lenZ = length(z);
+    return 0.5f * log(lenZ) * (lenZ / length(dz));
+}
+
+// Returns the number of iterations before z escaped
+int juliaRecurrence(INOUT(vec4) z, INOUT(vec4) dz)
+{
+    int i = 0;
+    for (; dot(z, z) < escapeThreshold && i < maxIterations; i++)
+    {
+        // dz = 2z_0*dz_0
+        dz = 2.0f*qMultiply(z, dz);
+
+        // z = z_0^2 + c
+        z = qSquare(z) + c;
+    }
+    return i;
+}
+
+float juliaDistance(vec3 p, float julia_w)
+{
+    // Initial z value and its derivative
+    vec4 z = vec4(p, julia_w);
+    vec4 dz = vec4(1.0f, 0.0f, 0.0f, 0.0f);
+
+    // Run escape time algorithm for Julia set
+    juliaRecurrence(z, dz);
+    return juliaDistanceEstimate(z, dz);
+}
@@ -0,0 +1,97 @@
+// Distance estimation and marching of the quaternion Julia set
+#include "ray.glsl"
+#include "quaternion.glsl"
+
+// * Fractal Uniforms
+layout(std140) uniform FractalBlock
+{
+    vec4 c;
+    int maxIterations;
+    float w;
+    float boundingRadius2;
+    float escapeThreshold;
+    float epsilon;
+};
+
+#include "fractal.glsl"
+
+// * Surface
+vec3 surfaceNormal(vec3 p, float julia_w)
+{
+    // Assuming w is defined correctly in the larger scope
+    // Convert 3D point to a Quaternion
+    vec4 qP = vec4(p, julia_w);
+
+    float delta = 0.000001;
+
+    // Perturbed points in the x, y, z direction by delta
+    float gradX, gradY, gradZ;
+
+    vec4 gx1 = qP - vec4(delta, 0, 0, 0);
+    vec4 gx2 = qP + vec4(delta, 0, 0, 0);
+    vec4 gy1 = qP - vec4(0, delta, 0, 0);
+    vec4 gy2 = qP + vec4(0, delta, 0, 0);
+    vec4 gz1 = qP - vec4(0, 0, delta, 0);
+    vec4 gz2 = qP + vec4(0, 0, delta, 0);
+
+    // Calculate Julia set iteration on perturbed points
+    for (int i = 0; i < maxIterations; i++)
+    {
+        if (dot(gx1, gx1) < escapeThreshold) gx1 = qSquare(gx1) + c;
+        if (dot(gx2, gx2) < escapeThreshold) gx2 = qSquare(gx2) + c;
+        if (dot(gy1, gy1) < escapeThreshold) gy1 = qSquare(gy1) + c;
+        if (dot(gy2, gy2) < escapeThreshold) gy2 = qSquare(gy2) + c;
+        if (dot(gz1, gz1) < escapeThreshold) gz1 = qSquare(gz1) + c;
+        if (dot(gz2, gz2) < escapeThreshold) gz2 = qSquare(gz2) + c;
+    }
+
+    // Gradient approximation
+    gradX = length(gx2) - length(gx1);
+    gradY = length(gy2) - length(gy1);
+    gradZ = length(gz2) - length(gz1);
+
+    // Return normal of the approximated gradient
+    vec3 N = vec3(gradX, gradY, gradZ);
+    N = normalize(N);
+
+    return N;
+}
+
+// * Marching
+bool marchJulia(Ray ray, float rayLength, float julia_w, out vec3 intersectionPoint, out int iterations)
+{
+    // Test ray at different points until an intersection is found
+    float distanceEstimate;
+    while (length2(rayAt(ray, rayLength)) < boundingRadius2)
+    {
+        // Initial z value and its derivative
+        vec4 z = vec4(rayAt(ray, rayLength), julia_w);
+        vec4 dz = vec4(1.0, 0.0, 0.0, 0.0);
+
+        // Run escape time algorithm for Julia set
+        iterations = juliaRecurrence(z, dz);
+        
+        // Check for intersection
+        distanceEstimate = juliaDistanceEstimate(z, dz);
+        if (distanceEstimate < epsilon)
+        {
+            // Handle intersection
+            intersectionPoint = rayAt(ray, rayLength);
+            return true;
+        }
+            
+        // If there is no intersection, then update ray length and run again
+        rayLength += distanceEstimate;
+    }
+
+
+    return false;
+}
+
+bool intersectJulia(Ray ray, float julia_w, out vec3 normal, out vec3 intersectionPoint, out int iterations)
+{
+    if (!marchJulia(ray, 1.0, julia_w, intersectionPoint, iterations)) return false;
+
+    normal = surfaceNormal(intersectionPoint, julia_w);
+    return true;
+}
@@ -0,0 +1,48 @@
+#version 330 core
+
+// Evaluates the shared kernel for KernelCheck, one case per column and one group of functions per row
+
+// * Inputs / Outputs
+out vec4 Result;
+
+uniform sampler2D inputs;  // The a and b of each case in rows 0 and 1
+
+// * Fractal Uniforms, with the names the kernel reads from FractalBlock
+uniform vec4 c;
+uniform int maxIterations;
+uniform float boundingRadius2;
+uniform float escapeThreshold;
+
+// * Kernel
+#include "ray.glsl"
+#include "quaternion.glsl"
+#include "fractal.glsl"
+#include "brdf.glsl"
+
+// Keep in step with KernelCheck::evaluate
+vec4 evaluate(int row, vec4 a, vec4 b)
+{
+    if (row == 0) return qSquare(a);
+    if (row == 1) return qMultiply(a, b);
+    if (row == 2)
+    {
+        Ray ray = Ray(2.0*a.xyz, b.xyz);  // Far enough out to miss the bounding sphere too
+        return vec4(juliaDistanceEstimate(a, b), juliaDistance(a.xyz, a.w), hitSphere(ray), exitSphere(ray));
+    }
+
+    vec3 N = normalize(a.xyz);
+    vec3 V = normalize(b.xyz);
+    vec3 L = normalize(vec3(a.w, b.w, 1.0));
+    vec3 H = normalize(V + L);
+    float NdotV = max(dot(N, V), 0.0);
+    float HdotV = max(dot(H, V), 0.0);
+    return vec4(DistributionGGX(N, H, 0.3), GeometrySmith(N, V, L, 0.2), GeometrySchlickGGX(NdotV, 0.2), fresnelSchlick(HdotV, vec3(0.04, 0.5, 0.9)).z);
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    vec4 a = texelFetch(inputs, ivec2(texel.x, 0), 0);
+    vec4 b = texelFetch(inputs, ivec2(texel.x, 1), 0);
+    Result = evaluate(texel.y, a, b);
+}
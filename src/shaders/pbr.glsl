@@ -0,0 +1,57 @@
+// Cook-Torrance shading under a single point light
+
+#include "brdf.glsl"
+
+// * Material Uniforms, the parts of the BRDF that only depend on the material
+layout(std140) uniform MaterialBlock
+{
+    float roughnessA2;  // GGX alpha squared, roughness^4
+    float roughnessK;   // Schlick-GGX k for a point light, (roughness + 1)^2 / 8
+    vec3 diffuse;       // Linear albedo * (1 - metallic) / PI
+    vec3 F0;
+};
+
+// * Light Uniforms
+layout(std140) uniform LightBlock
+{
+    vec3 lightPos;
+    vec3 lightRadiance;  // Linear colour times intensity
+};
+
+// * Physically Based Renderer
+vec3 PBR(vec3 N, vec3 P, vec3 V)
+{
+    vec3 Lo = vec3(0.0);
+    // for light in lights
+    // {
+    vec3 L = normalize(lightPos - P);
+    vec3 H = normalize(V + L);
+    float NdotL = max(dot(N, L), 0.0);  
+
+    float dist = length(lightPos - P);
+    float attenuation = 1.0 / (dist * dist);
+    vec3 radiance = lightRadiance * attenuation;
+
+    // Cook-Torrance BRDF
+    float NDF = DistributionGGX(N, H, roughnessA2);
+    float G = GeometrySmith(N, V, L, roughnessK);
+    vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
+    
+    vec3 num = NDF * G * F;
+    float denom = 4.0 * max(dot(N, V), 0.0) * NdotL + 0.0001;
+    vec3 specular = num / denom;
+
+    // Calculate reflective and refractive indexes, metals have no diffuse part which `diffuse` already accounts for
+    vec3 kS = F;
+    vec3 kD = vec3(1.0) - kS;
+
+    Lo += (kD * diffuse + specular) * radiance * NdotL;
+    // }
+
+    return Lo;
+
+    // ? Ambient lighting
+    // float ao = 1.0; // Ambient occlusion
+    // vec3 ambient = vec3(0.03) * diffuse * PI * ao;
+    // return ambient + Lo;
+}
@@ -0,0 +1,14 @@
+// Shared with the CPU through juliaKernel.h, so only GLSL that glm also compiles
+// * Quaternion operations
+vec4 qSquare(vec4 q)
+{
+	vec3 v = vec3(q.y, q.z, q.w);
+	return vec4(q.x*q.x - dot(v, v), 2.0f*q.x*v);
+}
+
+vec4 qMultiply(vec4 q1, vec4 q2)
+{
+	vec3 v1 = vec3(q1.y, q1.z, q1.w);
+	vec3 v2 = vec3(q2.y, q2.z, q2.w);
+	return vec4(q1.x*q2.x - dot(v1, v2), q1.x*v2 + q2.x*v1 + cross(v1, v2));
+}
@@ -0,0 +1,14 @@
+// Shared with the CPU through juliaKernel.h, so only GLSL that glm also compiles
+// * Structs
+struct Ray { vec3 pos, dir; };
+
+// * Utility functions
+vec3 rayAt(Ray ray, float t)
+{
+    return ray.pos + t*ray.dir;
+}
+
+float length2(vec3 v)
+{
+    return dot(v, v);
+}
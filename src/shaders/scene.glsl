@@ -0,0 +1,309 @@
+// The scene marched by main.frag and main.comp, everything but where the pixel comes from and where it goes
+
+// * Macrodefinitions
+#define FLOAT_MAX 3.402823466e+38
+#define FLOAT_MIN 1.175494351e-38
+
+// * Permutation flags, defined by the renderer for each variant so the branches on them fold away
+#ifdef TEST
+const bool test = true;
+#else
+const bool test = false;
+#endif
+
+#ifdef PIXEL_SAMPLING
+const bool doPixelSampling = true;
+#else
+const bool doPixelSampling = false;
+#endif
+
+#if defined(GRID_SAMPLING)
+const int samplingMethod = 2;
+#elif defined(JITTERED_GRID_SAMPLING)
+const int samplingMethod = 1;
+#else
+const int samplingMethod = 0;
+#endif
+
+#ifdef GAMMA_CORRECTION
+const bool doGammaCorrection = true;
+#else
+const bool doGammaCorrection = false;
+#endif
+
+#ifdef TEMPORAL_ANTI_ALIASING
+const bool doTemporalAntiAliasing = true;
+#else
+const bool doTemporalAntiAliasing = false;
+#endif
+
+// * Rendering Uniforms
+layout(std140) uniform RenderingBlock
+{
+    ivec2 resolution;
+    int samplesPerPixel;
+    bool doCheckerboard;
+    bool doUpsampling;
+    bool doPacketMarching;
+    float upsamplingScale;
+};
+
+// Set for every pass or draw
+uniform int renderedFrameCount;
+uniform sampler2D prevFrameTexture;
+
+// * World Uniforms
+layout(std140) uniform WorldBlock
+{
+    vec3 backgroundLinear;
+};
+uniform float u_time;
+
+// * Shared modules
+#include "camera.glsl"
+#include "julia.glsl"
+#include "pbr.glsl"
+
+// * Per-pixel state
+vec2 fragCoord = vec2(0.0); // Window coordinates of the pixel being rendered
+float pixelDepth = -1.0;    // Distance to the nearest surface hit by any sample, negative if none was
+vec3 pixelNormal = vec3(0.0);  // Surface normal at that nearest hit
+float pixelIterations = 0.0;   // Escape iterations at that nearest hit
+float pixelSamples = 0.0;      // Samples marched and how many of them hit the surface
+float pixelHits = 0.0;
+
+// * Utility functions
+void recordHit(vec3 P, vec3 N, int iterations)
+{
+    pixelHits += 1.0;
+
+    float depth = length(P - lookfrom);
+    if (pixelDepth < 0.0 || depth < pixelDepth)
+    {
+        pixelDepth = depth;
+        pixelNormal = N;
+        pixelIterations = float(iterations);
+    }
+}
+
+float rand()
+{
+    // Offset the seed by the frame count so passes rendered within the same frame don't repeat samples
+    float seed = u_time + float(renderedFrameCount);
+    return fract(sin(dot(fragCoord, vec2(12.9898, 78.233)) * seed) * 43758.5453);
+}
+
+vec3 gammaCorrect(vec3 linear)
+{
+    return pow(linear, vec3(1.0/2.2));
+}
+
+vec3 postProcess(vec3 colour)
+{
+
+    if (doGammaCorrection)
+    {
+        colour = gammaCorrect(colour);
+    }
+    
+    // Checkerboard and upsampled samples are blended with the history when they are resolved
+    if (doTemporalAntiAliasing && !doCheckerboard && !doUpsampling)
+    {
+        // Average colour with previous frame, the scene may only cover part of the texture
+        vec3 prevColour = texelFetch(prevFrameTexture, ivec2(fragCoord), 0).xyz;
+        colour = mix(prevColour, colour, 1.0 / (renderedFrameCount + 1));
+    }
+
+    return colour;
+
+}
+
+// * Colour calculation
+vec3 calculateColour(vec2 coord)
+{
+    pixelSamples += 1.0;
+
+    // Calculate w
+    float julia_w = w;
+    // if (test) julia_w = -1.0 + u_time/10.0;
+    
+    // Create ray from camera
+    vec3 pixelSample = viewportOrigin + (coord.x*pixelDW) + (coord.y*pixelDH);
+    Ray ray = Ray(lookfrom, normalize(pixelSample - lookfrom));
+
+    // Begin ray from bounding sphere's surface
+    ray.pos = rayAt(ray, hitSphere(ray));
+
+    // Check for julia intersection
+    vec3 N, P;
+    int iterations;
+    if (!intersectJulia(ray, julia_w, N, P, iterations)) return backgroundLinear;
+
+    recordHit(P, N, iterations);
+
+    // Calculate colour using preferred rendering method
+    vec3 finalColour = PBR(N, P, -ray.dir);
+    return finalColour;
+}
+
+// * Packet marching
+#define MAX_PACKET 16
+
+vec3 packetColour(vec2 coords[MAX_PACKET], int count)
+{
+    float julia_w = w;
+    vec3 dirs[MAX_PACKET];
+    float starts[MAX_PACKET];
+
+    // Rays from the camera and the centre ray of the packet
+    vec3 centre = vec3(0.0);
+    for (int i = 0; i < count; i++)
+    {
+        vec3 pixelSample = viewportOrigin + (coords[i].x*pixelDW) + (coords[i].y*pixelDH);
+        dirs[i] = normalize(pixelSample - lookfrom);
+        centre += dirs[i];
+    }
+    centre = normalize(centre);
+
+    // Widest gap between the centre and any ray per unit of distance, and the range where any ray is in the bounding sphere
+    float spread = 0.0, sharedStart = FLOAT_MAX, sharedEnd = 0.0;
+    for (int i = 0; i < count; i++)
+    {
+        Ray ray = Ray(lookfrom, dirs[i]);
+        float enter = hitSphere(ray);
+        spread = max(spread, length(dirs[i] - centre));
+
+        // Same starting offset from the sphere as intersectJulia
+        starts[i] = enter < 0.0 ? -1.0 : enter + 1.0;
+        if (enter >= 0.0)
+        {
+            sharedStart = min(sharedStart, starts[i]);
+            sharedEnd = max(sharedEnd, exitSphere(ray));
+        }
+    }
+
+    // March the centre ray with steps shrunk by the packet's radius, which keeps them conservative for every ray
+    float rayLength = sharedStart;
+    while (rayLength < sharedEnd)
+    {
+        float distanceEstimate = juliaDistance(lookfrom + rayLength*centre, julia_w);
+        float radius = rayLength*spread;
+
+        // The rays diverge once the packet is nearly as wide as the distance to the surface
+        if (radius > 0.9*distanceEstimate || distanceEstimate - radius < epsilon) break;
+        rayLength += distanceEstimate - radius;
+    }
+
+    // Refine each ray individually from where the packet stopped
+    vec3 colour = vec3(0.0);
+    for (int i = 0; i < count; i++)
+    {
+        vec3 P;
+        int iterations;
+        Ray ray = Ray(lookfrom, dirs[i]);
+        pixelSamples += 1.0;
+        if (starts[i] < 0.0 || !marchJulia(ray, max(rayLength, starts[i]), julia_w, P, iterations))
+        {
+            colour += backgroundLinear;
+            continue;
+        }
+
+        vec3 N = surfaceNormal(P, julia_w);
+        recordHit(P, N, iterations);
+        colour += PBR(N, P, -ray.dir);
+    }
+
+    return colour / float(count);
+}
+
+// * Pixel sampling methods
+vec3 randomPointSample()
+{
+    vec3 colour = vec3(0.0);
+    vec2 pixelCenter = fragCoord + 0.5;
+
+    for (int i = 0; i < samplesPerPixel; i++)
+    {
+        // Sample random window coords
+        vec2 offset = vec2(rand() - 0.5, rand() - 0.5);
+        vec2 sampledCoord = pixelCenter + offset;
+
+        // Calculate colour
+        colour += calculateColour(sampledCoord);
+    }
+
+    return colour / float(samplesPerPixel);
+}
+
+vec3 gridSample()
+{
+    // Small grids are marched together as one packet
+    if (doPacketMarching && samplesPerPixel*samplesPerPixel <= MAX_PACKET)
+    {
+        vec2 coords[MAX_PACKET];
+        for (int i = 0; i < samplesPerPixel; i++)
+            for (int j = 0; j < samplesPerPixel; j++)
+                coords[i*samplesPerPixel + j] = fragCoord + (vec2(i, j) + 0.5) / float(samplesPerPixel);
+
+        return packetColour(coords, samplesPerPixel*samplesPerPixel);
+    }
+
+    vec3 colour = vec3(0.0);
+
+    for (int i = 0; i < samplesPerPixel; i++)
+    {
+        for (int j = 0; j < samplesPerPixel; j++)
+        {
+            // Sample random window coords
+            vec2 offset = (vec2(i, j) + 0.5) / float(samplesPerPixel);
+            vec2 sampledCoord = fragCoord + offset;
+
+            // Calculate colour
+            colour += calculateColour(sampledCoord);
+        }
+    }
+
+    return colour / float(samplesPerPixel*samplesPerPixel);
+}
+
+vec3 jitteredGridSample()
+{
+    // Small grids are marched together as one packet
+    if (doPacketMarching && samplesPerPixel*samplesPerPixel <= MAX_PACKET)
+    {
+        vec2 coords[MAX_PACKET];
+        for (int i = 0; i < samplesPerPixel; i++)
+            for (int j = 0; j < samplesPerPixel; j++)
+                coords[i*samplesPerPixel + j] = fragCoord + (vec2(i, j) + vec2(rand(), rand())) / float(samplesPerPixel);
+
+        return packetColour(coords, samplesPerPixel*samplesPerPixel);
+    }
+
+    vec3 colour = vec3(0.0);
+
+    for (int i = 0; i < samplesPerPixel; i++)
+    {
+        for (int j = 0; j < samplesPerPixel; j++)
+        {
+            // Sample random window coords with jitter
+            vec2 offset = (vec2(i, j) + vec2(rand(), rand())) / float(samplesPerPixel);
+            vec2 sampledCoord = fragCoord + offset;
+
+            // Calculate colour
+            colour += calculateColour(sampledCoord);
+        }
+    }
+
+    return colour / float(samplesPerPixel*samplesPerPixel);
+}
+
+// Colour of the pixel at fragCoord, from the samples of the sampling method
+vec3 samplePixel()
+{
+    if (samplingMethod == 0)
+        return randomPointSample();
+    else if (samplingMethod == 1)
+        return jitteredGridSample();
+    else
+        return gridSample();
+}
@@ -0,0 +1,60 @@
+#version 330 core
+
+// * Inputs / Outputs
+in vec2 TexCoords;
+out vec4 FragColour;
+
+// * Macrodefinitions
+#define PI 3.14159265358979323846
+#define FILTER_SHARPNESS 2.29   // Gaussian fit of a Blackman-Harris window one output pixel wide
+
+// * Rendering Uniforms
+uniform bool doTemporalAntiAliasing;
+uniform int renderedFrameCount;
+uniform float upsamplingScale;
+uniform vec2 upsamplingJitter;
+uniform ivec2 sampleResolution;
+uniform sampler2D prevFrameTexture;
+uniform sampler2D sampleTexture;    // Jittered samples of this frame at the low resolution
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec2 center = gl_FragCoord.xy;
+
+    // Low resolution texel whose sample landed closest to this pixel
+    ivec2 nearest = ivec2(floor(center * upsamplingScale - upsamplingJitter));
+
+    // Reconstruction filter over the surrounding samples, distances measured in output pixels
+    vec3 colourSum = vec3(0.0);
+    float weightSum = 0.0;
+    for (int y = -1; y <= 1; y++)
+    {
+        for (int x = -1; x <= 1; x++)
+        {
+            ivec2 texel = clamp(nearest + ivec2(x, y), ivec2(0), sampleResolution - 1);
+            vec2 offset = (vec2(texel) + 0.5 + upsamplingJitter) / upsamplingScale - center;
+            float weight = exp(-FILTER_SHARPNESS * dot(offset, offset));
+
+            colourSum += weight * texelFetch(sampleTexture, texel, 0).rgb;
+            weightSum += weight;
+        }
+    }
+
+    // Far from every sample the weights underflow, fall back to the nearest one
+    ivec2 nearestTexel = clamp(nearest, ivec2(0), sampleResolution - 1);
+    vec3 colour = weightSum > 0.0 ? colourSum / weightSum : texelFetch(sampleTexture, nearestTexel, 0).rgb;
+
+    if (doTemporalAntiAliasing)
+    {
+        // Extended form of the 1/(n+1) running average: this frame counts with its filter weight instead of 1,
+        // and each previous frame is assumed to have contributed the filter's expected weight
+        float expectedWeight = PI / FILTER_SHARPNESS * upsamplingScale * upsamplingScale;
+        float alpha = renderedFrameCount == 0 ? 1.0 : weightSum / (weightSum + renderedFrameCount * expectedWeight);
+
+        vec3 prevColour = texelFetch(prevFrameTexture, pixel, 0).rgb;
+        colour = mix(prevColour, colour, alpha);
+    }
+
+    FragColour = vec4(colour, 1.0);
+}
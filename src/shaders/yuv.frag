@@ -0,0 +1,50 @@
+#version 330 core
+
+// * Inputs / Outputs
+out float Byte;  // One byte of the frame, the planes are packed one after another in file order
+
+// * Conversion Uniforms
+uniform ivec2 resolution;       // Of the frame, both even
+uniform sampler2D frameTexture;
+
+// Frames are stored top row first, unlike the texture
+vec3 fetch(ivec2 pixel)
+{
+    ivec2 texel = ivec2(pixel.x, resolution.y - 1 - pixel.y);
+    texel = clamp(texel, ivec2(0), textureSize(frameTexture, 0) - 1);
+    return clamp(texelFetch(frameTexture, texel, 0).rgb, 0.0, 1.0);
+}
+
+// BT.709 luma
+float luma(vec3 rgb)
+{
+    return dot(rgb, vec3(0.2126, 0.7152, 0.0722));
+}
+
+void main()
+{
+    // The target is `resolution.x` bytes wide, so the fragment's position is its offset into the frame
+    int index = int(gl_FragCoord.y)*resolution.x + int(gl_FragCoord.x);
+    int lumaSize = resolution.x*resolution.y;
+
+    // Y plane, limited range
+    if (index < lumaSize)
+    {
+        vec3 rgb = fetch(ivec2(index % resolution.x, index / resolution.x));
+        Byte = (16.0 + 219.0*luma(rgb)) / 255.0;
+        return;
+    }
+
+    // U then V plane, each sample averages a 2x2 block which puts it at the block's centre as in 4:2:0 JPEG
+    int chromaWidth = resolution.x / 2;
+    int chromaSize = lumaSize / 4;
+    int plane = (index - lumaSize) / chromaSize;
+    int chromaIndex = (index - lumaSize) % chromaSize;
+
+    ivec2 pixel = 2*ivec2(chromaIndex % chromaWidth, chromaIndex / chromaWidth);
+    vec3 rgb = 0.25*(fetch(pixel) + fetch(pixel + ivec2(1, 0)) + fetch(pixel + ivec2(0, 1)) + fetch(pixel + ivec2(1, 1)));
+
+    float y = luma(rgb);
+    float chroma = plane == 0 ? (rgb.b - y) / 1.8556 : (rgb.r - y) / 1.5748;
+    Byte = (128.0 + 224.0*chroma) / 255.0;
+}
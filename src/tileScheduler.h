@@ -0,0 +1,120 @@
+#ifndef TILE_SCHEDULER_H
+#define TILE_SCHEDULER_H
+
+#include <vector>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "imgui/imgui.h"
+
+class TileScheduler
+{
+public:
+
+    int tileSize = 128;
+
+    TileScheduler() {}
+
+    // Start a new pass over the whole viewport, rebuilding the tile order if the grid changed
+    void beginPass(glm::ivec2 newResolution, int newSceneVersion)
+    {
+        if (newResolution != resolution || tileSize != orderTileSize)
+        {
+            resolution = newResolution;
+            buildOrder();
+        }
+
+        sceneVersion = newSceneVersion;
+        cursor = 0;
+        active = true;
+    }
+
+    void cancelPass()
+    {
+        active = false;
+    }
+
+    // A pass is only resumed if it was started on the current version of the scene
+    bool isPassActive(int currentSceneVersion) const
+    {
+        return active && sceneVersion == currentSceneVersion;
+    }
+
+    bool isPassFinished() const
+    {
+        return cursor >= (int)order.size();
+    }
+
+    // Returns the next tile as (x, y, width, height) in pixels, clipped to the viewport
+    glm::ivec4 nextTile()
+    {
+        glm::ivec2 tile = order[cursor++] * orderTileSize;
+        if (isPassFinished()) active = false;
+
+        return glm::ivec4(
+            tile.x, tile.y,
+            glm::min(orderTileSize, resolution.x - tile.x),
+            glm::min(orderTileSize, resolution.y - tile.y)
+        );
+    }
+
+    int getTileCount() const
+    {
+        return (int)order.size();
+    }
+
+    int getTilesRemaining() const
+    {
+        return active ? (int)order.size() - cursor : (int)order.size();
+    }
+
+    bool menu()
+    {
+        bool updated = ImGui::SliderInt("Tile size", &tileSize, 16, 512);
+        if (updated) cancelPass();
+        return updated;
+    }
+
+private:
+
+    std::vector<glm::ivec2> order;
+    glm::ivec2 resolution = glm::ivec2(0, 0);
+    int orderTileSize = 0;
+    int sceneVersion = -1;
+    int cursor = 0;
+    bool active = false;
+
+    void buildOrder()
+    {
+        orderTileSize = tileSize;
+        int cols = (resolution.x + tileSize - 1) / tileSize;
+        int rows = (resolution.y + tileSize - 1) / tileSize;
+
+        order.clear();
+        for (int y = 0; y < rows; y++)
+            for (int x = 0; x < cols; x++)
+                order.push_back(glm::ivec2(x, y));
+
+        // Morton order keeps consecutive tiles spatially close, so partial progress fills in coherent blocks
+        std::sort(order.begin(), order.end(), [](const glm::ivec2 &a, const glm::ivec2 &b) {
+            return morton(a) < morton(b);
+        });
+    }
+
+    static unsigned int spreadBits(unsigned int n)
+    {
+        n &= 0x0000ffff;
+        n = (n | (n << 8)) & 0x00ff00ff;
+        n = (n | (n << 4)) & 0x0f0f0f0f;
+        n = (n | (n << 2)) & 0x33333333;
+        n = (n | (n << 1)) & 0x55555555;
+        return n;
+    }
+
+    static unsigned int morton(const glm::ivec2 &tile)
+    {
+        return spreadBits(tile.x) | (spreadBits(tile.y) << 1);
+    }
+
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef UNIFORM_BENCH_H
+#define UNIFORM_BENCH_H
+
+#include <GL/glew.h>
+#include <chrono>
+#include <iostream>
+#include <glm/glm.hpp>
+#include "shader.h"
+#include "renderer.h"
+
+// Times the uniforms the scene shader is sent every pass: through resolved handles, through the string setters and
+// their cached table, and looking every location up by name as the setters did before the table. Renderer::beginPass
+// is timed whole too, it's all the CPU work of a pass. Run with `main --bench-uniforms`
+class UniformBench
+{
+public:
+
+    static constexpr int PASSES = 20000;
+    static constexpr int REPEATS = 5;  // The best repeat is reported, the others are noise from the rest of the system
+
+    static void run(Renderer &renderer)
+    {
+        Shader shader("quad.vert", "main.frag");
+        shader.use();
+
+        Handles handles;
+        shader.getUniform("doSingleSample", handles.doSingleSample);
+        shader.getUniform("doLayers", handles.doLayers);
+        shader.getUniform("checkerboardParity", handles.checkerboardParity);
+        shader.getUniform("renderedFrameCount", handles.renderedFrameCount);
+        shader.getUniform("prevFrameTexture", handles.prevFrameTexture);
+        shader.getUniform("upsamplingJitter", handles.upsamplingJitter);
+        shader.getUniform("u_time", handles.u_time);
+
+        double handleTime = time([&](int pass)
+        {
+            handles.doSingleSample.set(false);
+            handles.doLayers.set(false);
+            handles.checkerboardParity.set(pass & 1);
+            handles.renderedFrameCount.set(pass);
+            handles.prevFrameTexture.set(0);
+            handles.upsamplingJitter.set(glm::vec2(0.25f, -0.25f));
+            handles.u_time.set((float)pass);
+        });
+
+        double setterTime = time([&](int pass)
+        {
+            shader.setBool("doSingleSample", false);
+            shader.setBool("doLayers", false);
+            shader.setInt("checkerboardParity", pass & 1);
+            shader.setInt("renderedFrameCount", pass);
+            shader.setInt("prevFrameTexture", 0);
+            shader.setVec2f("upsamplingJitter", glm::vec2(0.25f, -0.25f));
+            shader.setFloat("u_time", (float)pass);
+        });
+
+        GLuint ID = shader.getID();
+        double lookupTime = time([&](int pass)
+        {
+            glUniform1i(glGetUniformLocation(ID, "doSingleSample"), false);
+            glUniform1i(glGetUniformLocation(ID, "doLayers"), false);
+            glUniform1i(glGetUniformLocation(ID, "checkerboardParity"), pass & 1);
+            glUniform1i(glGetUniformLocation(ID, "renderedFrameCount"), pass);
+            glUniform1i(glGetUniformLocation(ID, "prevFrameTexture"), 0);
+            glUniform2f(glGetUniformLocation(ID, "upsamplingJitter"), 0.25f, -0.25f);
+            glUniform1f(glGetUniformLocation(ID, "u_time"), (float)pass);
+        });
+
+        double passTime = time([&](int pass) { renderer.beginPass(0); });
+
+        std::cout << "Scene uniforms per pass, best of " << REPEATS << " runs of " << PASSES << ":" << std::endl
+                  << "    handles           " << handleTime << " us" << std::endl
+                  << "    string setters    " << setterTime << " us" << std::endl
+                  << "    location lookups  " << lookupTime << " us" << std::endl
+                  << "Renderer::beginPass   " << passTime << " us" << std::endl;
+    }
+
+private:
+
+    struct Handles
+    {
+        Shader::Uniform<bool> doSingleSample, doLayers;
+        Shader::Uniform<int> checkerboardParity, renderedFrameCount, prevFrameTexture;
+        Shader::Uniform<float> u_time;
+        Shader::Uniform<glm::vec2> upsamplingJitter;
+    };
+
+    // Microseconds per call of `pass`, after a warm up so the driver has settled
+    template <typename F>
+    static double time(F pass)
+    {
+        for (int i = 0; i < PASSES / 10; i++) pass(i);
+        glFinish();
+
+        double best = 1e30;
+        for (int repeat = 0; repeat < REPEATS; repeat++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < PASSES; i++) pass(i);
+            double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            best = glm::min(best, elapsed / PASSES);
+            glFinish();
+        }
+        return best;
+    }
+
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef UNIFORM_BLOCK_H
+#define UNIFORM_BLOCK_H
+
+#include <GL/glew.h>
+#include <stdint.h>
+#include <memory>
+
+// A std140 uniform buffer holding a `T`, bound to one binding point that every program using the block reads from.
+// `data` is only sent when the block is marked dirty, or when a copy of it has written the buffer since
+template <typename T>
+class UniformBlock
+{
+public:
+
+    T data = {};
+    bool dirty = true;
+
+    UniformBlock()
+        : id(nextId())
+    {}
+
+    // Copies share the buffer but not its contents, each one sends its own data before it is next drawn with
+    UniformBlock(const UniformBlock &other)
+        : data(other.data), buffer(other.buffer), lastWriter(other.lastWriter), id(nextId())
+    {}
+
+    UniformBlock &operator=(const UniformBlock &other)
+    {
+        data = other.data;
+        dirty = true;
+        buffer = other.buffer;
+        lastWriter = other.lastWriter;
+        return *this;
+    }
+
+    void init(GLuint binding)
+    {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+
+        lastWriter = std::make_shared<uint64_t>(0);
+        dirty = true;
+    }
+
+    // Send `data` if the buffer doesn't already hold it
+    void upload()
+    {
+        if (!lastWriter || (!dirty && *lastWriter == id)) return;
+
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        *lastWriter = id;
+        dirty = false;
+    }
+
+private:
+
+    GLuint buffer = 0;
+    std::shared_ptr<uint64_t> lastWriter;  // Id of the copy whose data is in the buffer
+    uint64_t id;
+
+    static uint64_t nextId()
+    {
+        static uint64_t count = 0;
+        return ++count;
+    }
+
+};
+
+#endif
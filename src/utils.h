@@ -1,6 +1,9 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stdint.h>
+#include <stddef.h>
+
 #define PI 3.14159265358979323846
 
 class Interval
@@ -22,4 +25,29 @@ public:
 
 };
 
+// Element `index` of the Halton low-discrepancy sequence in base `base`, in [0, 1)
+inline float halton(int index, int base)
+{
+    float fraction = 1.0f, result = 0.0f;
+    while (index > 0)
+    {
+        fraction /= base;
+        result += fraction * (index % base);
+        index /= base;
+    }
+    return result;
+}
+
+// 64 bit FNV-1a of `size` bytes, continuing from `hash` to combine several values
+inline uint64_t hashBytes(const void *data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    const unsigned char *bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
 #endif
\ No newline at end of file
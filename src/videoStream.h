@@ -0,0 +1,354 @@
+#ifndef VIDEO_STREAM_H
+#define VIDEO_STREAM_H
+
+#include <GL/glew.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+#include "shader.h"
+#include "fullQuad.h"
+#include "pixelReadback.h"
+
+// Streams frames to stdout or a named pipe as YUV4MPEG2 or raw RGB, for an encoder to consume as they're rendered
+class VideoStream
+{
+public:
+
+    enum Format { Y4M = 0, RGB = 1 };
+
+    static constexpr int BUFFER_COUNT = 4;
+    static constexpr int OPEN_TIMEOUT_MS = 30000;  // How long a pipe may go without a reader before the stream fails
+
+    VideoStream() {}
+
+    ~VideoStream()
+    {
+        close();
+    }
+
+    void init()
+    {
+        shader = Shader("quad.vert", "yuv.frag");
+        glGenFramebuffers(1, &yuvFBO);
+        glGenTextures(1, &yuvTexture);
+    }
+
+    // Start a stream of `width`*`height` frames, both even. A `path` of "-" is stdout, anything else is opened on
+    // the writer thread so a pipe without a reader yet doesn't hang the app, frames past the buffers are dropped until
+    // one connects
+    void open(const std::string &path, int streamFormat, int width, int height, int fps)
+    {
+        close();
+
+        // A reader going away should end the stream, not the process
+        signal(SIGPIPE, SIG_IGN);
+
+        this->path = path;
+        format = streamFormat;
+        frameWidth = width;
+        frameHeight = height;
+        frameRate = fps;
+        frameSize = format == Y4M ? (size_t)width * height * 3 / 2 : (size_t)width * height * 3;
+
+        freeBuffers.clear();
+        for (int i = 0; i < BUFFER_COUNT; i++)
+        {
+            buffers[i].resize(frameSize);
+            freeBuffers.push_back(i);
+        }
+        queueHead = queueCount = 0;
+        stopping = failed = outputOpen = false;
+        frameCount = droppedFrames = 0;
+
+        writer = std::thread([this]() { work(); });
+    }
+
+    // Write every queued frame and close the output, or give up on opening it
+    void close()
+    {
+        if (!writer.joinable()) return;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        queueCondition.notify_all();
+        writer.join();
+    }
+
+    // Convert `frameTexture` to planar YUV on the GPU, read `getReadFormat` from the returned FBO for `push`
+    GLuint convert(FullQuad &quad, GLuint frameTexture)
+    {
+        resize();
+
+        glDisable(GL_BLEND);
+        shader.use();
+        shader.setVec2i("resolution", frameWidth, frameHeight);
+        shader.setInt("frameTexture", 0);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, frameTexture);
+        glBindFramebuffer(GL_FRAMEBUFFER, yuvFBO);
+        glViewport(0, 0, frameWidth, frameHeight * 3 / 2);
+        quad.render();
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glEnable(GL_BLEND);
+
+        return yuvFBO;
+    }
+
+    // Size and format of the reads `push` expects, the YUV planes are packed `width` bytes wide
+    glm::ivec2 getReadSize() const
+    {
+        return format == Y4M ? glm::ivec2(frameWidth, frameHeight * 3 / 2) : glm::ivec2(frameWidth, frameHeight);
+    }
+
+    GLenum getReadFormat() const
+    {
+        return format == Y4M ? GL_RED : GL_RGB;
+    }
+
+    // Copy a finished read into a free buffer for the writer thread, waiting while the encoder is behind. The frame
+    // is dropped instead if the stream failed, or if every buffer is full and the output isn't open yet
+    void push(const PixelReadback::Frame &frame)
+    {
+        int buffer;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            freeCondition.wait(lock, [this]() { return !freeBuffers.empty() || failed || !outputOpen; });
+            if (failed || freeBuffers.empty())
+            {
+                droppedFrames++;
+                return;
+            }
+            buffer = freeBuffers.back();
+            freeBuffers.pop_back();
+        }
+
+        // The YUV planes are already top row first, RGB rows are flipped here
+        unsigned char *data = buffers[buffer].data();
+        if (format == Y4M)
+        {
+            memcpy(data, frame.pixels, frameSize);
+        }
+        else
+        {
+            size_t rowSize = (size_t)frameWidth * 3;
+            for (int y = 0; y < frameHeight; y++)
+                memcpy(data + rowSize * y, frame.pixels + rowSize * (frameHeight - 1 - y), rowSize);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue[(queueHead + queueCount) % BUFFER_COUNT] = buffer;
+            queueCount++;
+        }
+        queueCondition.notify_one();
+    }
+
+    int getFormat() const
+    {
+        return format;
+    }
+
+    bool isOpen() const
+    {
+        return writer.joinable();
+    }
+
+    // The output couldn't be opened or the reader went away, frames are dropped from then on
+    bool hasFailed()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return failed;
+    }
+
+    int getFrameCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return frameCount;
+    }
+
+    int getDroppedFrames()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return droppedFrames;
+    }
+
+    // False until the writer thread has opened the output, e.g. while a pipe waits for its reader
+    bool isOutputOpen()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return outputOpen;
+    }
+
+private:
+
+    // * Conversion
+    Shader shader;
+    GLuint yuvTexture, yuvFBO;
+    glm::ivec2 yuvSize = glm::ivec2(0, 0);
+
+    // * Stream
+    std::string path;
+    int format = Y4M;
+    int frameWidth = 0, frameHeight = 0, frameRate = 30;
+    size_t frameSize = 0;
+
+    // * Writer thread
+    std::vector<unsigned char> buffers[BUFFER_COUNT];
+    std::vector<int> freeBuffers;
+    int queue[BUFFER_COUNT];
+    int queueHead = 0, queueCount = 0;
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable queueCondition, freeCondition;
+    bool stopping = false;
+    bool failed = false;
+    bool outputOpen = false;
+    int frameCount = 0;
+    int droppedFrames = 0;
+
+    void resize()
+    {
+        glm::ivec2 size = getReadSize();
+        if (format != Y4M || size == yuvSize) return;
+        yuvSize = size;
+
+        glBindTexture(GL_TEXTURE_2D, yuvTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, size.x, size.y, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, yuvFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, yuvTexture, 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "YUV frame buffer not complete" << std::endl;
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // Open the output without blocking, a pipe fails with ENXIO until it has a reader so the open is retried until
+    // one connects, the stream is closed or the timeout runs out
+    FILE *openOutput()
+    {
+        if (path == "-") return stdout;
+
+        auto giveUp = std::chrono::steady_clock::now() + std::chrono::milliseconds(OPEN_TIMEOUT_MS);
+        while (true)
+        {
+            int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NONBLOCK, 0644);
+            if (fd >= 0)
+            {
+                // Writes block again, so a slow encoder holds the queue back rather than losing frames
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+                FILE *file = fdopen(fd, "wb");
+                if (!file) ::close(fd);
+                return file;
+            }
+            if (errno != ENXIO)
+            {
+                std::cerr << "Could not open " << path << std::endl;
+                return nullptr;
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            bool stopped = queueCondition.wait_for(lock, std::chrono::milliseconds(50), [this]() { return stopping; });
+            if (stopped || std::chrono::steady_clock::now() > giveUp)
+            {
+                std::cerr << "No reader opened " << path << std::endl;
+                return nullptr;
+            }
+        }
+    }
+
+    void work()
+    {
+        bool toStdout = path == "-";
+        FILE *file = openOutput();
+        if (!file)
+        {
+            fail();
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            outputOpen = true;
+        }
+
+        if (file && format == Y4M)
+        {
+            // Limited range BT.709, chroma sited at the centre of every 2x2 block
+            fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n", frameWidth, frameHeight, frameRate);
+        }
+
+        while (true)
+        {
+            int buffer;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                queueCondition.wait(lock, [this]() { return stopping || queueCount > 0; });
+                if (queueCount == 0) break;
+
+                buffer = queue[queueHead];
+                queueHead = (queueHead + 1) % BUFFER_COUNT;
+                queueCount--;
+            }
+
+            if (!hasFailed())
+            {
+                bool written = format != Y4M || fputs("FRAME\n", file) >= 0;
+                written = written && fwrite(buffers[buffer].data(), 1, frameSize, file) == frameSize;
+                if (written)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    frameCount++;
+                }
+                else
+                {
+                    std::cerr << "Video stream " << path << " was closed by its reader" << std::endl;
+                    fail();
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                freeBuffers.push_back(buffer);
+            }
+            freeCondition.notify_one();
+        }
+
+        if (file)
+        {
+            if (toStdout) fflush(file);
+            else fclose(file);
+        }
+    }
+
+    // Also wakes a push waiting for a buffer, which then drops its frame
+    void fail()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            failed = true;
+        }
+        freeCondition.notify_all();
+    }
+
+};
+
+#endif
@@ -10,7 +10,12 @@ public:
 
     int width, height;
     double aspectRatio;
+    float renderScale = 1.0f;  // Fraction of the window the scene is rendered at, upscaled for display
     GLuint textures[2], FBOs[2];
+    GLuint stencilRBO;                // Shared by both ping-pong FBOs to mask which pixels a draw touches
+    GLuint sampleTexture, sampleFBO;  // Intermediate samples (colour and depth) that get resolved into the ping-pong textures
+    GLuint gBufferTexture;            // Second target of the sample FBO, surface normal and depth of the samples
+    GLuint guideTexture, guideFBO;    // Normal and depth at every pixel centre, guides the denoiser
 
     Window () {}
 
@@ -31,10 +36,19 @@ public:
         for (int i = 0; i < 2; i++)
         {
             glBindTexture(GL_TEXTURE_2D, textures[i]);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         }
+        glBindRenderbuffer(GL_RENDERBUFFER, stencilRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindTexture(GL_TEXTURE_2D, sampleTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+        glBindTexture(GL_TEXTURE_2D, gBufferTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+        glBindTexture(GL_TEXTURE_2D, guideTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
         glBindTexture(GL_TEXTURE_2D, 0);
     }
 
@@ -43,6 +57,12 @@ public:
         return glm::ivec2(width, height);
     }
 
+    // The scene is rendered into the bottom-left corner of the textures at this size
+    glm::ivec2 renderResolution() const
+    {
+        return glm::max(glm::ivec2(glm::vec2(width, height) * renderScale + 0.5f), glm::ivec2(1, 1));
+    }
+
 private:
 
     void initFBOs()
@@ -50,23 +70,73 @@ private:
         // Create FBOs and textures
         glGenFramebuffers(2, FBOs);
         glGenTextures(2, textures);
+        glGenRenderbuffers(1, &stencilRBO);
+
+        glBindRenderbuffer(GL_RENDERBUFFER, stencilRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
 
         for (int i = 0; i < 2; i++)
         {
-            // Set texture parameters
+            // Set texture parameters, the format is sized so the compute backend can write them as images
             glBindTexture(GL_TEXTURE_2D, textures[i]);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
             
             // Attach textures to FBOs
             glBindFramebuffer(GL_FRAMEBUFFER, FBOs[i]);
             glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[i], 0);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, stencilRBO);
 
             if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
                 std::cerr << "Frame buffer not complete" << std::endl;
         }
         
+        // Create the sample FBO, it holds depth in the alpha channel so it needs full float precision
+        glGenFramebuffers(1, &sampleFBO);
+        glGenTextures(1, &sampleTexture);
+        glGenTextures(1, &gBufferTexture);
+
+        GLuint sampleTextures[2] = { sampleTexture, gBufferTexture };
+        for (int i = 0; i < 2; i++)
+        {
+            glBindTexture(GL_TEXTURE_2D, sampleTextures[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, sampleFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, sampleTexture, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gBufferTexture, 0);
+
+        // Shaders write the colour to location 0 and the G-buffer to location 1
+        GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, drawBuffers);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "Sample frame buffer not complete" << std::endl;
+
+        // Create the guide FBO, only the G-buffer output of the scene shader is kept
+        glGenFramebuffers(1, &guideFBO);
+        glGenTextures(1, &guideTexture);
+
+        glBindTexture(GL_TEXTURE_2D, guideTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, guideFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, guideTexture, 0);
+
+        GLenum guideDrawBuffers[2] = { GL_NONE, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, guideDrawBuffers);
+        glReadBuffer(GL_COLOR_ATTACHMENT1);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "Guide frame buffer not complete" << std::endl;
+
         // Unbind texture and frame buffers
         glBindTexture(GL_TEXTURE_2D, 0);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);